@@ -0,0 +1,505 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+// Self-checks of the behaviors measured by the other benchmarks, against
+// simple references. Each check prints its result, and the exit code is the
+// number of failed checks, so that the program also runs as a test (ctest).
+//
+// Usage: bench_checks
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <SFML/System.hpp>
+#include "quadtree.hpp"
+#include "linear_quadtree.hpp"
+#include "hash_grid.hpp"
+#include "spatial_index.hpp"
+#include "pair_cache.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include "particles.hpp"
+#include "workers.hpp"
+#include "constants.hpp"
+
+static int failures = 0;
+
+static void check(const char* name, bool ok) {
+  printf("%-60s %s\n", name, ok ? "ok" : "FAILED");
+  if (not ok)
+    failures++;
+}
+
+static Particles field(unsigned int count, float side, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> uniform(0, side);
+  std::uniform_real_distribution<float> velocity(-150, 150);
+  Particles particles;
+
+  for (unsigned int i=0; i<count; i++)
+    particles.add(sf::Vector2f(uniform(rng), uniform(rng)), sf::Vector2f(velocity(rng), velocity(rng)),
+                  ENTITY_RADIUS);
+
+  return particles;
+}
+
+/**
+ * Rebuilding the same field does not reach the heap once the pools are warm
+ */
+static void checkAllocations() {
+  const Particles particles = field(NB_ENTITY, WINDOW_WIDTH, 1);
+  Workers workers(4);
+
+  for (auto insertion: {Insertion::Point, Insertion::Bounds}) {
+    Node node(sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+    node.setInsertion(insertion);
+
+    node.build(particles, particles.size());
+    const unsigned long warm = node.getAllocations();
+    node.build(particles, particles.size());
+    check(insertion == Insertion::Point ? "steady-state build allocations, point"
+                                        : "steady-state build allocations, bounds",
+          warm > 0 && node.getAllocations() == warm);
+
+    node.build(particles, particles.size(), workers);
+    const unsigned long parallel = node.getAllocations();
+    node.build(particles, particles.size(), workers);
+    check(insertion == Insertion::Point ? "steady-state parallel build allocations, point"
+                                        : "steady-state parallel build allocations, bounds",
+          node.getAllocations() == parallel);
+  }
+}
+
+/**
+ * The linear quadtree locates every element in a leaf storing it, also for
+ * positions one float step away from node borders
+ */
+static void checkLinearLocate() {
+  for (int side: {WINDOW_WIDTH, 1000, 777}) {
+    Particles particles = field(NB_ENTITY, side, 2);
+
+    // Borders of the deepest nodes, and their float neighbors
+    const int cells = 1 << LINEAR_MAX_DEPTH;
+    for (int i=1; i<cells; i+=cells/1024) {
+      const float x = float(side) * i / cells;
+      const float y = float(side) * (cells - i) / cells;
+      for (float bx: {std::nextafter(x, 0.f), x, std::nextafter(x, float(side))})
+        for (float by: {std::nextafter(y, 0.f), y, std::nextafter(y, float(side))})
+          particles.add(sf::Vector2f(bx, by), sf::Vector2f(), ENTITY_RADIUS);
+    }
+
+    for (auto insertion: {Insertion::Point, Insertion::Bounds}) {
+      LinearQuadtree linear(sf::Rect<int>(0, 0, side, side));
+      linear.setInsertion(insertion);
+      linear.setCapacity(1);
+      linear.build(particles, particles.size());
+
+      std::vector<LinearQuadtree::Leaf> leaves;
+      linear.getLeaves(&leaves);
+      std::vector<std::vector<LinearQuadtree::Leaf>> owners(particles.size());
+      for (auto leaf: leaves) {
+        unsigned int* elements;
+        unsigned int count = linear.getElements(leaf, &elements);
+        for (unsigned int i=0; i<count; i++)
+          owners[elements[i]].push_back(leaf);
+      }
+
+      bool ok = true;
+      for (unsigned int id=0; id<particles.size(); id++) {
+        const auto& stored = owners[id];
+        ok &= std::find(stored.begin(), stored.end(), linear.locate(particles[id].getPosition())) != stored.end();
+      }
+
+      char name[64];
+      snprintf(name, sizeof(name), "linear quadtree locate() matches storage, %s, side %d",
+               insertion == Insertion::Point ? "point" : "bounds", side);
+      check(name, ok);
+    }
+  }
+}
+
+/**
+ * Radius queries of the hashed grid, run concurrently, find the particles of
+ * a brute-force scan
+ */
+static void checkHashGridQueries() {
+  const Particles particles = field(NB_ENTITY, WINDOW_WIDTH, 3);
+  HashGrid grid(sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+  Workers workers(4);
+  grid.build(particles, particles.size());
+
+  // Small disks overlap a few cells, large ones more buckets than a query
+  // keeps on the stack
+  for (float radius: {10.f, 300.f}) {
+    const unsigned int queries = 256;
+    std::vector<unsigned int> found(queries);
+    std::vector<unsigned int> expected(queries);
+
+    workers.run(queries, [&](unsigned int, unsigned int q) {
+      found[q] = Spatial::queryRadius(grid, particles, particles[q].getPosition(), radius, nullptr, 0);
+    });
+
+    for (unsigned int q=0; q<queries; q++) {
+      const sf::Vector2f center = particles[q].getPosition();
+      for (unsigned int i=0; i<particles.size(); i++) {
+        const sf::Vector2f d = particles[i].getPosition() - center;
+        expected[q] += d.x*d.x + d.y*d.y <= radius*radius;
+      }
+    }
+
+    check(radius < 100 ? "concurrent hashed grid queries, small disks"
+                       : "concurrent hashed grid queries, large disks", found == expected);
+  }
+}
+
+/**
+ * Nearest neighbors of the quadtree are the k closest particles of a
+ * brute-force scan
+ */
+static void checkNearest() {
+  const Particles particles = field(2*NB_ENTITY, WINDOW_WIDTH, 4);
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> uniform(0, WINDOW_WIDTH);
+  const unsigned int k = 8;
+
+  for (auto insertion: {Insertion::Point, Insertion::Bounds}) {
+    Node node(sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+    node.setInsertion(insertion);
+    node.build(particles, particles.size());
+
+    bool ok = true;
+    std::vector<float> distances(particles.size());
+    for (unsigned int q=0; q<500; q++) {
+      const sf::Vector2f center(uniform(rng), uniform(rng));
+      Neighbor neighbors[k];
+      const unsigned int found = node.nearest(particles, center, k, neighbors);
+
+      for (unsigned int i=0; i<particles.size(); i++) {
+        const sf::Vector2f d = particles[i].getPosition() - center;
+        distances[i] = std::sqrt(d.x*d.x + d.y*d.y);
+      }
+      std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+
+      ok &= found == k;
+      for (unsigned int i=0; i<found; i++) {
+        const sf::Vector2f d = particles[neighbors[i].id].getPosition() - center;
+        ok &= neighbors[i].distance == distances[i] && std::sqrt(d.x*d.x + d.y*d.y) == distances[i];
+      }
+    }
+
+    check(insertion == Insertion::Point ? "nearest neighbors match a brute-force scan, point"
+                                        : "nearest neighbors match a brute-force scan, bounds", ok);
+  }
+}
+
+/**
+ * Contact events of the pair cache match the difference of the pair sets of
+ * consecutive frames, through growth and removals of the hash table
+ */
+static void checkPairCache() {
+  using Pair = std::pair<unsigned int, unsigned int>;
+  using Event = std::tuple<unsigned int, unsigned int, PairCache::Phase>;
+  std::mt19937 rng(6);
+  std::uniform_int_distribution<unsigned int> particle(0, 199);
+  PairCache cache;
+  std::set<Pair> last;
+  bool ok = true;
+
+  for (unsigned int frame=0; frame<200; frame++) {
+    // A pair set growing then shrinking, some pairs touched twice and in
+    // both orders, as with bounds insertion
+    const unsigned int touches = frame < 100 ? 20 * frame : 20 * (200 - frame);
+    std::set<Pair> current;
+    std::vector<Event> expected;
+    cache.beginFrame();
+
+    for (unsigned int t=0; t<touches; t++) {
+      const unsigned int a = particle(rng);
+      const unsigned int b = particle(rng);
+      if (a == b)
+        continue;
+
+      const Pair pair(std::min(a, b), std::max(a, b));
+      const bool fresh = not last.count(pair) && not current.count(pair);
+      if (not current.count(pair))
+        expected.emplace_back(pair.first, pair.second, last.count(pair) ? PairCache::Phase::Stay : PairCache::Phase::Begin);
+      current.insert(pair);
+      ok &= cache.touch(a, b) == fresh;
+    }
+    cache.endFrame();
+
+    std::set<Event> ends;
+    for (const Pair& pair: last)
+      if (not current.count(pair))
+        ends.emplace(pair.first, pair.second, PairCache::Phase::End);
+
+    // Ends come last, in no particular order
+    const auto& events = cache.getEvents();
+    ok &= events.size() == expected.size() + ends.size() && cache.size() == current.size();
+    for (unsigned int e=0; ok && e<events.size(); e++) {
+      const Event event(events[e].a, events[e].b, events[e].phase);
+      ok &= e < expected.size() ? event == expected[e] : ends.count(event) == 1;
+    }
+
+    last.swap(current);
+  }
+
+  check("pair cache events match a std::set reference", ok);
+}
+
+/**
+ * A particle spawned in the slot of a despawned one begins its contacts
+ * instead of inheriting those of the former particle
+ */
+static void checkSlotReuse() {
+  Config config;
+  config.contacts = true;
+  Simulation simulation(config, sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+
+  // Two overlapping particles at rest, collision passes without moving them
+  const Particles::Handle a = simulation.spawn(sf::Vector2f(100, 100), sf::Vector2f(), ENTITY_RADIUS);
+  const Particles::Handle b = simulation.spawn(sf::Vector2f(101, 100), sf::Vector2f(), ENTITY_RADIUS);
+  simulation.build();
+  simulation.resolveCollisions();
+  const auto& events = simulation.getContacts();
+  bool ok = events.size() == 1 && events[0].phase == PairCache::Phase::Begin;
+
+  simulation.despawn(b);
+  const Particles::Handle c = simulation.spawn(sf::Vector2f(101, 100), sf::Vector2f(), ENTITY_RADIUS);
+  simulation.build();
+  simulation.resolveCollisions();
+
+  // The contact of the despawned particle ends, the one of the new one begins
+  ok &= c.slot == b.slot && c.generation != b.generation && events.size() == 2;
+  ok &= events[0].phase == PairCache::Phase::End && events[1].phase == PairCache::Phase::Begin;
+  ok &= std::min(events[1].a, events[1].b) == std::min(a.slot, c.slot);
+
+  check("despawned slot reused by a spawn begins new contacts", ok);
+}
+
+/**
+ * A snapshot gives back the particles, the area and the step rate it was
+ * written with
+ */
+static void checkSnapshot() {
+  const Particles particles = field(1000, WINDOW_WIDTH, 7);
+  const char* path = "checks_snapshot.bin";
+  Snapshot::Header header;
+  Particles loaded;
+
+  bool ok = Snapshot::save(path, particles, sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT), 42, 1.0 / 60)
+         && Snapshot::load(path, &loaded, &header);
+  std::remove(path);
+
+  ok = ok && header.rate == 60 && header.steps == 42 && header.width == WINDOW_WIDTH
+          && loaded.x == particles.x && loaded.y == particles.y && loaded.vx == particles.vx
+          && loaded.vy == particles.vy && loaded.radius == particles.radius;
+  check("snapshot round trip, step rate included", ok);
+}
+
+/**
+ * Incremental updates leave particles out of the tree in their border leaf,
+ * where insertions put them
+ */
+static void checkOutOfRoot() {
+  Particles particles = field(NB_ENTITY, WINDOW_WIDTH, 8);
+  std::mt19937 rng(9);
+  std::uniform_real_distribution<float> uniform(0, WINDOW_WIDTH);
+  std::uniform_real_distribution<float> outside(1, 100);
+
+  // Past each side and corner of the root
+  for (unsigned int i=0; i<1000; i++) {
+    const float out = outside(rng);
+    const float x = i % 3 == 0 ? -out : i % 3 == 1 ? WINDOW_WIDTH + out : uniform(rng);
+    const float y = i % 4 == 0 ? -out : i % 4 == 1 ? WINDOW_HEIGHT + out : uniform(rng);
+    particles.add(sf::Vector2f(x, y), sf::Vector2f(), ENTITY_RADIUS);
+  }
+
+  Node node(sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+  node.build(particles, particles.size());
+  bool ok = node.update(particles, particles.size()) == 0;
+
+  // Farther away, out of the root
+  for (unsigned int i=NB_ENTITY; i<particles.size(); i++) {
+    particles.x[i] += particles.x[i] < 0 ? -50 : particles.x[i] >= WINDOW_WIDTH ? 50 : 0;
+    particles.y[i] += particles.y[i] < 0 ? -50 : particles.y[i] >= WINDOW_HEIGHT ? 50 : 0;
+  }
+  ok &= node.update(particles, particles.size()) == 0;
+
+  // Every particle is in the leaf an insertion would store it in
+  std::vector<Node*> leaves;
+  node.getLeaves(&leaves);
+  for (auto leaf: leaves) {
+    unsigned int* elements;
+    unsigned int count = leaf->getElements(&elements);
+    for (unsigned int i=0; i<count; i++)
+      ok &= node.locate(particles[elements[i]].getPosition()) == leaf;
+  }
+
+  check("unmoved particles out of the root are not re-inserted", ok);
+}
+
+/**
+ * Step head-on pairs of particles which cross within one step without
+ * continuous collision detection
+ * @param settings
+ * @return number of pairs which kept their order and bounced back
+ */
+static unsigned int headOn(const Config& config) {
+  Simulation simulation(config, sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+
+  // 100 pixels per step each, 60 pixels apart
+  const float speed = 100 / config.timeStep;
+  const unsigned int pairs = 50;
+  for (unsigned int k=0; k<pairs; k++) {
+    const float y = 100 + 20 * k;
+    simulation.spawn(sf::Vector2f(500, y), sf::Vector2f(speed, 0), ENTITY_RADIUS);
+    simulation.spawn(sf::Vector2f(560, y), sf::Vector2f(-speed, 0), ENTITY_RADIUS);
+  }
+
+  simulation.step(config.timeStep);
+
+  const Particles& particles = simulation.getParticles();
+  unsigned int bounced = 0;
+  for (unsigned int k=0; k<pairs; k++) {
+    const unsigned int a = 2*k, b = 2*k + 1;
+    bounced += particles.x[a] < particles.x[b] && particles.vx[a] < 0 && particles.vx[b] > 0;
+  }
+
+  return bounced;
+}
+
+/**
+ * With continuous collision detection, particles heading at each other
+ * faster than their size per step bounce back instead of crossing
+ */
+static void checkHeadOn() {
+  Config config;
+  config.insertion = Insertion::Bounds;
+  check("head-on pairs cross without --ccd", headOn(config) == 0);
+
+  config.continuous = true;
+  for (auto response: {Response::Impulse, Response::Bounce})
+    for (auto broadPhase: {BroadPhase::Index, BroadPhase::Sweep})
+      for (unsigned int threads: {1, 4}) {
+        config.response = response;
+        config.broadPhase = broadPhase;
+        config.threads = threads;
+
+        char name[64];
+        snprintf(name, sizeof(name), "head-on pairs bounce with --ccd, %s, %s, %u %s",
+                 response == Response::Impulse ? "impulse" : "bounce",
+                 broadPhase == BroadPhase::Index ? "index" : "sweep", threads, threads > 1 ? "threads" : "thread");
+        check(name, headOn(config) == 50);
+      }
+}
+
+/**
+ * Impulses conserve the momentum and the center of mass of a dense pile of
+ * particles of various sizes, whatever the number of threads
+ */
+static void checkMomentum() {
+  for (unsigned int threads: {1, 4}) {
+    Config config;
+    config.threads = threads;
+    Simulation simulation(config, sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+    std::mt19937 rng(10);
+    std::uniform_real_distribution<float> pile(550, 650);
+    std::uniform_real_distribution<float> velocity(-100, 100);
+    std::uniform_real_distribution<float> radius(1, 4);
+
+    for (unsigned int i=0; i<2000; i++)
+      simulation.spawn(sf::Vector2f(pile(rng), pile(rng)), sf::Vector2f(velocity(rng), velocity(rng)), radius(rng));
+
+    // Sums of m*v and m*x, and of their magnitudes for the tolerance
+    auto moments = [&](double* out) {
+      const Particles& p = simulation.getParticles();
+      std::fill(out, out + 6, 0.0);
+      for (unsigned int i=0; i<p.size(); i++) {
+        const double m = double(p.radius[i]) * p.radius[i];
+        out[0] += m * p.vx[i];
+        out[1] += m * p.vy[i];
+        out[2] += m * p.x[i];
+        out[3] += m * p.y[i];
+        out[4] += m * (std::abs(p.vx[i]) + std::abs(p.vy[i]));
+        out[5] += m;
+      }
+    };
+
+    double before[6], after[6];
+    moments(before);
+    simulation.build();
+    simulation.resolveCollisions();
+    moments(after);
+
+    const double tolerance = 1e-5;
+    const bool ok = simulation.getStats().pairsColliding > 0
+                 && std::abs(after[0] - before[0]) <= tolerance * before[4]
+                 && std::abs(after[1] - before[1]) <= tolerance * before[4]
+                 && std::abs(after[2] - before[2]) / before[5] <= 1e-3
+                 && std::abs(after[3] - before[3]) / before[5] <= 1e-3;
+    check(threads > 1 ? "impulses conserve momentum, 4 threads" : "impulses conserve momentum, 1 thread", ok);
+  }
+}
+
+/**
+ * An elastic impulse between two particles of different masses gives the
+ * velocities of a one-dimensional elastic collision
+ */
+static void checkElastic() {
+  Config config;
+  config.restitution = 1;
+  Simulation simulation(config, sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+
+  // Masses 4 and 16, overlapping by one pixel while getting closer
+  simulation.spawn(sf::Vector2f(600, 600), sf::Vector2f(100, 0), 2);
+  simulation.spawn(sf::Vector2f(605, 600), sf::Vector2f(-50, 0), 4);
+  simulation.build();
+  simulation.resolveCollisions();
+
+  // (m1 - m2) v1 + 2 m2 v2 over m1 + m2, and the same the other way round
+  const Particles& p = simulation.getParticles();
+  const bool ok = std::abs(p.vx[0] - -140) < 1e-3f && std::abs(p.vx[1] - 10) < 1e-3f
+               && p.vy[0] == 0 && p.vy[1] == 0;
+  check("elastic impulse between two particles", ok);
+}
+
+int main() {
+  checkAllocations();
+  checkLinearLocate();
+  checkHashGridQueries();
+  checkNearest();
+  checkPairCache();
+  checkSlotReuse();
+  checkSnapshot();
+  checkOutOfRoot();
+  checkHeadOn();
+  checkMomentum();
+  checkElastic();
+
+  return failures;
+}
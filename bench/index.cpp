@@ -0,0 +1,244 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+
+// Compares the spatial indexes (pointer-based quadtree with float and
+// fixed-point bounds, linear quadtree, uniform grid, hashed grid, loose
+// quadtree) on several workloads, with point and
+// bounds insertion (the loose quadtree always stores elements once):
+// build time, candidate pair enumeration with the exact test, and radius
+// queries, plus nearest neighbors queries on the pointer-based quadtree.
+// The fastest index of each workload for build and pairs is marked with a
+// star.
+//
+// Usage: bench_index [particles] [radius] [frames] [side]
+//
+// By default, the world grows with the particle count so that the uniform
+// workload keeps the density of the application (NB_ENTITY particles in the
+// window). A larger side, e.g. 1000000, spreads them over a sparse world.
+// The mixed workload is uniform, with radii from 1 to 100 times the given
+// one.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <SFML/System.hpp>
+#include "quadtree.hpp"
+#include "linear_quadtree.hpp"
+#include "grid.hpp"
+#include "hash_grid.hpp"
+#include "loose_quadtree.hpp"
+#include "spatial_index.hpp"
+#include "particles.hpp"
+#include "constants.hpp"
+
+// Radius and nearest neighbors queries per frame
+#define QUERIES 1000
+#define QUERY_RADIUS 20
+#define NEIGHBORS 8
+
+enum class Distribution {
+  Uniform,
+  Clustered,
+  Elongated,
+  Mixed
+};
+
+static const char* name(Distribution d) {
+  switch (d) {
+    case Distribution::Uniform: return "uniform";
+    case Distribution::Clustered: return "clustered";
+    case Distribution::Elongated: return "elongated";
+    case Distribution::Mixed: return "mixed";
+  }
+  return "";
+}
+
+struct Result {
+  double buildMs;
+  double pairsMs;
+  double queryMs;
+  unsigned long pairs;
+  unsigned long found;
+};
+
+template<typename Index>
+Result measure(Index& index, Insertion insertion, const std::vector<Particles>& frames,
+               const std::vector<sf::Vector2f>& queries) {
+  Result r = {0, 0, 0, 0, 0};
+  std::vector<typename Index::Leaf> leaves;
+
+  index.setInsertion(insertion);
+
+  for (auto& particles: frames) {
+    sf::Clock clock;
+    index.build(particles, particles.size());
+    r.buildMs += clock.restart().asMicroseconds() / 1000.0;
+
+    leaves.clear();
+    index.getLeaves(&leaves);
+    Spatial::forEachPair(index, particles, leaves, [&](unsigned int i, unsigned int j) {
+      if (particles.isColliding(i, j))
+        r.pairs++;
+    });
+    r.pairsMs += clock.restart().asMicroseconds() / 1000.0;
+
+    for (auto& q: queries)
+      Spatial::queryRadius(index, particles, q, QUERY_RADIUS, [&](unsigned int) {
+        r.found++;
+      });
+    r.queryMs += clock.restart().asMicroseconds() / 1000.0;
+  }
+
+  return r;
+}
+
+static Particles generate(Distribution distribution, unsigned int count, float radius, float side,
+                          std::mt19937& rng) {
+  std::uniform_real_distribution<float> uniform(0, side);
+  std::uniform_real_distribution<float> band(side * 0.48f, side * 0.52f);
+  std::normal_distribution<float> cluster(0, side/50);
+  std::uniform_real_distribution<float> scale(0, std::log(100.0f));
+  Particles particles;
+
+  std::vector<sf::Vector2f> centers(32);
+  for (auto& c: centers)
+    c = sf::Vector2f(uniform(rng), uniform(rng));
+
+  for (unsigned int i=0; i<count; i++) {
+    sf::Vector2f p;
+    float r = radius;
+
+    switch (distribution) {
+      case Distribution::Uniform:
+        p = sf::Vector2f(uniform(rng), uniform(rng));
+        break;
+      case Distribution::Clustered:
+        p = centers[i % centers.size()] + sf::Vector2f(cluster(rng), cluster(rng));
+        break;
+      case Distribution::Elongated:
+        p = sf::Vector2f(uniform(rng), band(rng));
+        break;
+      case Distribution::Mixed:
+        p = sf::Vector2f(uniform(rng), uniform(rng));
+        r = radius * std::exp(scale(rng));
+        break;
+    }
+
+    p.x = std::min(std::max(p.x, 0.0f), side - 1);
+    p.y = std::min(std::max(p.y, 0.0f), side - 1);
+    particles.add(p, sf::Vector2f(0, 0), r);
+  }
+
+  return particles;
+}
+
+void print(const char* name, const Result& r, unsigned int frames, const Result& best) {
+  if (r.buildMs < 0) {
+    printf("  %-8s skipped\n", name);
+    return;
+  }
+
+  printf("  %-8s build %8.3f ms%s | pairs %8.3f ms%s | queries %8.3f ms | pairs %9lu | found %9lu\n",
+         name, r.buildMs/frames, r.buildMs == best.buildMs ? "*" : " ",
+         r.pairsMs/frames, r.pairsMs == best.pairsMs ? "*" : " ",
+         r.queryMs/frames, r.pairs, r.found);
+}
+
+int main(int argc, char** argv) {
+  unsigned int nbParticles = argc > 1 ? atoi(argv[1]) : 10000;
+  float radius = argc > 2 ? atof(argv[2]) : 2;
+  unsigned int nbFrames = argc > 3 ? atoi(argv[3]) : 10;
+
+  float side = argc > 4 ? atof(argv[4]) : std::ceil(WINDOW_WIDTH * std::sqrt(double(nbParticles) / NB_ENTITY));
+  sf::Rect<int> area(0, 0, side, side);
+
+  printf("%u particles of radius %g in %gx%g, %u frames (per-frame times, total pairs)\n",
+         nbParticles, radius, side, side, nbFrames);
+
+  for (auto distribution: {Distribution::Uniform, Distribution::Clustered, Distribution::Elongated,
+                           Distribution::Mixed})
+    for (auto insertion: {Insertion::Point, Insertion::Bounds}) {
+      std::mt19937 rng(1);
+      std::vector<Particles> frames;
+      for (unsigned int f=0; f<nbFrames; f++)
+        frames.push_back(generate(distribution, nbParticles, radius, side, rng));
+
+      // Queries around particles, where they are the most useful
+      std::vector<sf::Vector2f> queries;
+      for (unsigned int q=0; q<QUERIES; q++)
+        queries.push_back(frames[0][rng() % nbParticles].getPosition());
+
+      Node node(area);
+      FixedNode fixed(area);
+      LinearQuadtree linear(area);
+      Grid grid(area);
+      HashGrid hash(area);
+      LooseQuadtree loose(area);
+
+      // The largest mixed particles would be copied into thousands of
+      // tree leaves: minutes per frame
+      const bool copies = distribution == Distribution::Mixed && insertion == Insertion::Bounds;
+      const Result skipped = {-1, -1, -1, 0, 0};
+
+      Result results[] = {
+        copies ? skipped : measure(node, insertion, frames, queries),
+        copies ? skipped : measure(fixed, insertion, frames, queries),
+        copies ? skipped : measure(linear, insertion, frames, queries),
+        measure(grid, insertion, frames, queries),
+        measure(hash, insertion, frames, queries),
+        measure(loose, insertion, frames, queries)
+      };
+
+      Result best = results[5];
+      for (auto& r: results)
+        if (r.buildMs >= 0) {
+          best.buildMs = std::min(best.buildMs, r.buildMs);
+          best.pairsMs = std::min(best.pairsMs, r.pairsMs);
+        }
+
+      printf("%s, %s insertion\n", name(distribution), insertion == Insertion::Bounds ? "bounds" : "point");
+      print("node", results[0], nbFrames, best);
+      print("fixed", results[1], nbFrames, best);
+      print("linear", results[2], nbFrames, best);
+      print("grid", results[3], nbFrames, best);
+      print("hash", results[4], nbFrames, best);
+      print("loose", results[5], nbFrames, best);
+
+      if (copies)
+        continue;
+
+      // Nearest neighbors, on the last frame
+      Neighbor neighbors[NEIGHBORS];
+      unsigned long found = 0;
+      sf::Clock clock;
+      for (auto& q: queries)
+        found += node.nearest(frames.back(), q, NEIGHBORS, neighbors);
+      printf("  node %u-NN %8.3f ms | found %lu\n", NEIGHBORS,
+             clock.getElapsedTime().asMicroseconds() / 1000.0, found);
+    }
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+// Compares point insertion (by center, pairs tested within a leaf) with
+// bounds insertion (in every overlapped leaf, pairs deduplicated) on both
+// quadtree implementations. Reports build and detection time, build time
+// per inserted particle, and the pairs found against a brute-force
+// reference.
+//
+// Usage: bench_insertion [particles] [radius] [frames]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <SFML/System.hpp>
+#include "quadtree.hpp"
+#include "linear_quadtree.hpp"
+#include "spatial_index.hpp"
+#include "narrowphase.hpp"
+#include "particles.hpp"
+#include "constants.hpp"
+
+struct Result {
+  double buildMs;
+  double detectMs;
+  unsigned long pairs;
+};
+
+template<typename Tree>
+Result measure(Tree& tree, Insertion insertion, const std::vector<Particles>& frames) {
+  Result r = {0, 0, 0};
+  std::vector<typename Tree::Leaf> leaves;
+  NarrowPhase narrowPhase;
+
+  tree.setInsertion(insertion);
+
+  for (auto& particles: frames) {
+    sf::Clock clock;
+    tree.build(particles, particles.size());
+    r.buildMs += clock.restart().asMicroseconds() / 1000.0;
+
+    leaves.clear();
+    tree.getLeaves(&leaves);
+
+    for (auto leaf: leaves) {
+      unsigned int* elements;
+      unsigned int n = tree.getElements(leaf, &elements);
+      narrowPhase.load(particles, elements, n);
+
+      for (unsigned int i=0; i<n; i++) {
+        const unsigned int* colliding;
+        unsigned int nbColliding = narrowPhase.collide(i, &colliding);
+
+        for (unsigned int k=0; k<nbColliding; k++) {
+          if (insertion == Insertion::Bounds) {
+            // Same ownership rule as the simulation
+            if (not Spatial::owns(tree, leaf, Spatial::bounds(particles, elements[i]),
+                                  Spatial::bounds(particles, elements[colliding[k]])))
+              continue;
+          }
+          r.pairs++;
+        }
+      }
+    }
+    r.detectMs += clock.restart().asMicroseconds() / 1000.0;
+  }
+
+  return r;
+}
+
+unsigned long bruteForce(const Particles& particles) {
+  unsigned long pairs = 0;
+  for (unsigned int i=0; i<particles.size(); i++)
+    for (unsigned int j=i+1; j<particles.size(); j++)
+      if (particles.isColliding(i, j))
+        pairs++;
+  return pairs;
+}
+
+void print(const char* name, const Result& r, unsigned int frames, unsigned int particles,
+           unsigned long expected) {
+  printf("%-14s build %8.3f ms | %7.1f ns/insert | detect %8.3f ms | pairs %8lu / %lu\n",
+         name, r.buildMs/frames, r.buildMs * 1e6 / frames / particles, r.detectMs/frames, r.pairs, expected);
+}
+
+int main(int argc, char** argv) {
+  unsigned int nbParticles = argc > 1 ? atoi(argv[1]) : 10000;
+  float radius = argc > 2 ? atof(argv[2]) : 2;
+  unsigned int nbFrames = argc > 3 ? atoi(argv[3]) : 10;
+
+  srand(0);
+  std::vector<Particles> frames(nbFrames);
+  for (auto& particles: frames)
+    for (unsigned int i=0; i<nbParticles; i++)
+      particles.add(sf::Vector2f(rand() % WINDOW_WIDTH, rand() % WINDOW_HEIGHT),
+                    sf::Vector2f(0, 0), radius);
+
+  unsigned long expected = 0;
+  for (auto& particles: frames)
+    expected += bruteForce(particles);
+
+  sf::Rect<int> area(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+  Node node(area);
+  FixedNode fixed(area);
+  LinearQuadtree linear(area);
+
+  printf("%u particles of radius %g, %u frames (per-frame times, total pairs)\n",
+         nbParticles, radius, nbFrames);
+  print("node point", measure(node, Insertion::Point, frames), nbFrames, nbParticles, expected);
+  print("node bounds", measure(node, Insertion::Bounds, frames), nbFrames, nbParticles, expected);
+  print("fixed point", measure(fixed, Insertion::Point, frames), nbFrames, nbParticles, expected);
+  print("fixed bounds", measure(fixed, Insertion::Bounds, frames), nbFrames, nbParticles, expected);
+  print("linear point", measure(linear, Insertion::Point, frames), nbFrames, nbParticles, expected);
+  print("linear bounds", measure(linear, Insertion::Bounds, frames), nbFrames, nbParticles, expected);
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+// Compares the pointer-based Node and the flat LinearQuadtree on the same
+// point sets: time and cache misses for the build and for a full leaf scan
+// that reads every referenced position, as resolveCollisions() does.
+// The linear tree is measured twice: built by insertions, and bulk-built
+// from Morton codes. The pointer-based tree is then built in parallel with
+// 2, 4, ... up to the given number of threads.
+//
+// Usage: bench_layout [points] [frames] [threads]
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <SFML/System.hpp>
+#include "quadtree.hpp"
+#include "linear_quadtree.hpp"
+#include "constants.hpp"
+#include "perf.hpp"
+#include "workers.hpp"
+
+struct Point {
+  sf::Vector2f position;
+
+  inline const sf::Vector2f& getPosition() const {
+    return position;
+  }
+
+  inline float getRadius() const {
+    return 0;
+  }
+};
+
+struct Result {
+  double buildMs;
+  double scanMs;
+  long long buildMisses;
+  long long scanMisses;
+  float checksum;
+};
+
+template<typename Tree>
+Result measure(Tree& tree, const std::vector<std::vector<Point>>& frames, bool bulk,
+               Workers* workers = nullptr) {
+  Result r = {0, 0, 0, 0, 0};
+  CacheMissCounter counter;
+  std::vector<typename Tree::Leaf> leaves;
+
+  for (auto& points: frames) {
+    sf::Clock clock;
+    counter.start();
+    if (workers != nullptr)
+      tree.build(points, points.size(), *workers);
+    else if (bulk)
+      tree.build(points, points.size());
+    else {
+      tree.clear();
+      for (unsigned int i=0; i<points.size(); i++)
+        tree.add(points, i);
+    }
+    r.buildMisses += counter.stop();
+    r.buildMs += clock.restart().asMicroseconds() / 1000.0;
+
+    counter.start();
+    leaves.clear();
+    tree.getLeaves(&leaves);
+    for (auto leaf: leaves) {
+      unsigned int* elements;
+      unsigned int n = tree.getElements(leaf, &elements);
+      for (unsigned int i=0; i<n; i++)
+        r.checksum += points[elements[i]].position.x;
+    }
+    r.scanMisses += counter.stop();
+    r.scanMs += clock.restart().asMicroseconds() / 1000.0;
+  }
+
+  return r;
+}
+
+void print(const char* name, const Result& r, unsigned int frames) {
+  printf("%-8s build %8.3f ms  %12lld misses | scan %8.3f ms  %12lld misses | checksum %g\n",
+         name, r.buildMs/frames, r.buildMisses/frames, r.scanMs/frames, r.scanMisses/frames,
+         r.checksum);
+}
+
+int main(int argc, char** argv) {
+  unsigned int nbPoints = argc > 1 ? atoi(argv[1]) : 100000;
+  unsigned int nbFrames = argc > 2 ? atoi(argv[2]) : 20;
+  unsigned int nbThreads = argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency();
+
+  srand(0);
+  std::vector<std::vector<Point>> frames(nbFrames, std::vector<Point>(nbPoints));
+  for (auto& points: frames)
+    for (auto& p: points)
+      p.position = sf::Vector2f(rand() % WINDOW_WIDTH, rand() % WINDOW_HEIGHT);
+
+  sf::Rect<int> area(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+  Node node(area);
+  LinearQuadtree linear(area);
+
+  printf("%u points, %u frames (per-frame averages, misses = -1 if perf is unavailable)\n",
+         nbPoints, nbFrames);
+  print("node", measure(node, frames, false), nbFrames);
+  print("linear", measure(linear, frames, false), nbFrames);
+  print("morton", measure(linear, frames, true), nbFrames);
+
+  // Same tree as "node", built on several threads
+  char name[16];
+  for (unsigned int threads=2; threads<=nbThreads; threads*=2) {
+    Workers workers(threads);
+    snprintf(name, sizeof(name), "node x%u", threads);
+    print(name, measure(node, frames, false, &workers), nbFrames);
+  }
+
+  return 0;
+}
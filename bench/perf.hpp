@@ -0,0 +1,106 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Hardware cache-miss counter for the calling thread.
+ * Relies on Linux perf events; readings are -1 when they are not available
+ * (other platforms, containers, perf_event_paranoid too high).
+ */
+class CacheMissCounter {
+public:
+  /**
+   * Constructor
+   */
+  CacheMissCounter():_fd(-1) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    _fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  /**
+   * Destructor
+   */
+  ~CacheMissCounter() {
+#ifdef __linux__
+    if (_fd >= 0)
+      close(_fd);
+#endif
+  }
+
+  CacheMissCounter(const CacheMissCounter&) = delete;
+  CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+  /**
+   * Reset and start counting
+   */
+  void start() {
+#ifdef __linux__
+    if (_fd >= 0) {
+      ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  /**
+   * Stop counting
+   * @return cache misses since start(), or -1 if unavailable
+   */
+  long long stop() {
+#ifdef __linux__
+    long long count;
+    if (_fd >= 0) {
+      ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(_fd, &count, sizeof(count)) == sizeof(count))
+        return count;
+    }
+#endif
+    return -1;
+  }
+
+private:
+  // perf event file descriptor
+  int _fd;
+};
+
+#endif
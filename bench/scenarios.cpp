@@ -0,0 +1,232 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+// Headless regression benchmark: runs the Simulation pipeline (particle
+// update, tree build, collision pass) without window or frame limit over a
+// matrix of particle counts, spatial distributions and leaf capacities,
+// with a fixed seed. Prints one CSV row per scenario on stdout.
+//
+// Usage: bench_scenarios [--counts 1000,10000,...] [--distributions uniform,clustered,hotspot,elongated]
+//                        [--capacities 4,10,32] [--frames N] [--warmup N] [--seed N]
+//                        [application options, e.g. --threads N --insertion bounds]
+//
+// The world grows with the particle count so that the uniform scenario
+// keeps the density of the application (NB_ENTITY particles in the window).
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <SFML/System.hpp>
+#include "config.hpp"
+#include "constants.hpp"
+#include "simulation.hpp"
+
+enum class Distribution {
+  Uniform,
+  Clustered,
+  Hotspot,
+  Elongated
+};
+
+static const char* name(Distribution d) {
+  switch (d) {
+    case Distribution::Uniform: return "uniform";
+    case Distribution::Clustered: return "clustered";
+    case Distribution::Hotspot: return "hotspot";
+    case Distribution::Elongated: return "elongated";
+  }
+  return "";
+}
+
+struct Scenario {
+  Distribution distribution;
+  unsigned int count;
+  unsigned int capacity;
+};
+
+struct Settings {
+  std::vector<unsigned int> counts = {1000, 10000, 100000, 1000000};
+  std::vector<Distribution> distributions = {Distribution::Uniform, Distribution::Clustered, Distribution::Hotspot,
+                                             Distribution::Elongated};
+  std::vector<unsigned int> capacities = {4, 10, 32};
+  unsigned int frames = 20;
+  unsigned int warmup = 2;
+  unsigned int seed = 1;
+  Config config;
+};
+
+static std::vector<unsigned int> parseList(const char* list) {
+  std::vector<unsigned int> values;
+  for (const char* p=list; *p != '\0'; ) {
+    values.push_back(std::strtoul(p, nullptr, 10));
+    p = std::strchr(p, ',');
+    if (p == nullptr)
+      break;
+    p++;
+  }
+  return values;
+}
+
+static Settings parse(int argc, char** argv) {
+  Settings settings;
+  std::vector<char*> others = {argv[0]};
+
+  for (int i=1; i<argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i+1 < argc ? argv[i+1] : nullptr;
+
+    if (value == nullptr)
+      others.push_back(argv[i]);
+    else if (std::strcmp(arg, "--counts") == 0)
+      settings.counts = parseList(argv[++i]);
+    else if (std::strcmp(arg, "--capacities") == 0)
+      settings.capacities = parseList(argv[++i]);
+    else if (std::strcmp(arg, "--frames") == 0)
+      settings.frames = std::atoi(argv[++i]);
+    else if (std::strcmp(arg, "--warmup") == 0)
+      settings.warmup = std::atoi(argv[++i]);
+    else if (std::strcmp(arg, "--seed") == 0)
+      settings.seed = std::atoi(argv[++i]);
+    else if (std::strcmp(arg, "--distributions") == 0) {
+      settings.distributions.clear();
+      std::string list = argv[++i];
+      for (auto d: {Distribution::Uniform, Distribution::Clustered, Distribution::Hotspot, Distribution::Elongated})
+        if (list.find(name(d)) != std::string::npos)
+          settings.distributions.push_back(d);
+    }
+    else
+      others.push_back(argv[i]);
+  }
+
+  settings.config = Config::parse(others.size(), others.data());
+  return settings;
+}
+
+/**
+ * Fill the simulation with particles
+ * @param simulation
+ * @param scenario
+ * @param world size
+ * @param random generator
+ */
+static void populate(Simulation& simulation, const Scenario& scenario, float side, std::mt19937& rng) {
+  std::uniform_real_distribution<float> uniform(0, side);
+  std::uniform_int_distribution<int> speed(3, 5);
+  std::bernoulli_distribution sign(0.5);
+  std::normal_distribution<float> cluster(0, side/50);
+  std::normal_distribution<float> hotspot(0, side/40);
+  std::uniform_real_distribution<float> band(side * 0.48f, side * 0.52f);
+
+  std::vector<sf::Vector2f> centers(32);
+  for (auto& c: centers)
+    c = sf::Vector2f(uniform(rng), uniform(rng));
+
+  for (unsigned int i=0; i<scenario.count; i++) {
+    sf::Vector2f p;
+
+    switch (scenario.distribution) {
+      case Distribution::Uniform:
+        p = sf::Vector2f(uniform(rng), uniform(rng));
+        break;
+      case Distribution::Clustered:
+        p = centers[i % centers.size()] + sf::Vector2f(cluster(rng), cluster(rng));
+        break;
+      case Distribution::Hotspot:
+        p = sf::Vector2f(side/2 + hotspot(rng), side/2 + hotspot(rng));
+        break;
+      case Distribution::Elongated:
+        p = sf::Vector2f(uniform(rng), band(rng));
+        break;
+    }
+
+    p.x = std::min(std::max(p.x, 0.0f), side - 1);
+    p.y = std::min(std::max(p.y, 0.0f), side - 1);
+
+    sf::Vector2f v((sign(rng) ? 1 : -1) * speed(rng), (sign(rng) ? 1 : -1) * speed(rng));
+    v *= float(FRAME_RATE);
+    simulation.getParticles().add(p, v, ENTITY_RADIUS);
+  }
+}
+
+static void run(const Settings& settings, const Scenario& scenario) {
+  Config config = settings.config;
+  config.capacity = scenario.capacity;
+
+  int side = std::ceil(WINDOW_WIDTH * std::sqrt(double(scenario.count) / NB_ENTITY));
+  Simulation simulation(config, sf::Rect<int>(0, 0, side, side));
+  std::mt19937 rng(settings.seed);
+  populate(simulation, scenario, side, rng);
+
+  // Fixed time step, one step per frame
+  const double dt = config.timeStep;
+
+  for (unsigned int f=0; f<settings.warmup; f++)
+    simulation.step(dt);
+
+  double updateNs = 0, buildNs = 0, collideNs = 0;
+  unsigned long tested = 0, colliding = 0;
+
+  for (unsigned int f=0; f<settings.frames; f++) {
+    sf::Clock clock;
+    simulation.update(dt);
+    updateNs += clock.restart().asMicroseconds() * 1000.0;
+    simulation.build();
+    buildNs += clock.restart().asMicroseconds() * 1000.0;
+    simulation.resolveCollisions();
+    collideNs += clock.restart().asMicroseconds() * 1000.0;
+
+    tested += simulation.getStats().pairsTested;
+    colliding += simulation.getStats().pairsColliding;
+  }
+
+  double samples = double(settings.frames) * scenario.count;
+  printf("%s,%s,%s,%u,%u,%u,%u,%u,%.2f,%.2f,%.2f,%.0f,%.1f,%.0f\n",
+         config.broadPhase == BroadPhase::Sweep ? "sweep" : SPATIAL_INDEX_NAME,
+         name(scenario.distribution),
+         config.insertion == Insertion::Bounds ? "bounds" : "point",
+         config.incremental ? 1 : 0,
+         scenario.count, scenario.capacity, config.threads, settings.frames,
+         updateNs / samples, buildNs / samples, collideNs / samples,
+         double(tested) / settings.frames, double(colliding) / settings.frames,
+         collideNs > 0 ? tested / (collideNs * 1e-9) : 0.0);
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  Settings settings = parse(argc, argv);
+
+  printf("index,distribution,insertion,incremental,particles,capacity,threads,frames,"
+         "update_ns_per_particle,build_ns_per_particle,collide_ns_per_particle,"
+         "pairs_tested_per_frame,pairs_colliding_per_frame,pairs_tested_per_second\n");
+
+  for (auto distribution: settings.distributions)
+    for (auto count: settings.counts)
+      for (auto capacity: settings.capacities)
+        run(settings, Scenario{distribution, count, capacity});
+
+  return 0;
+}
@@ -21,20 +21,25 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE. */
 
 
+
 #ifndef APP_HPP
 #define APP_HPP
 
+#include <atomic>
+#include <thread>
 #include <SFML/Graphics.hpp>
-#include "entity.hpp"
-#include "quadtree.hpp"
+#include "config.hpp"
+#include "renderer.hpp"
+#include "simulation.hpp"
 #include "constants.hpp"
 
 class App {
   public:
   /**
    * Constructor
+   * @param settings
    */
-  App();
+  App(const Config& config = Config());
 
   /**
    * Destructor
@@ -57,20 +62,66 @@ class App {
   void render();
 
   /**
-   * Update state
+   * Update state by fixed time steps
+   * @param time since last update
+   */
+  void update(double dt);
+
+
+private:
+  /**
+   * Main loop of the pipelined mode: display frame N while the simulation
+   * thread computes frame N+1
    */
-  void update();
+  void _runPipeline();
 
   /**
-   * Find and handle collisions
+   * Simulation thread of the pipelined mode
    */
-  void resolveCollisions();
+  void _simulate();
 
+  /**
+   * Draw a snapshot in the window
+   * @param snapshot
+   */
+  void _display(const Renderer& renderer);
 
-private:
+#ifdef ENABLE_PROFILER
+  /**
+   * Draw phase durations and counters of the last frame
+   */
+  void _drawOverlay();
+
+  // Profiler overlay
+  bool _overlay;
+  bool _hasFont;
+  sf::Font _font;
+  sf::Text _text;
+#endif
+
+  Config _config;
   sf::RenderWindow* _window;
-  Node* _quadtree;
-  Entity _entities[NB_ENTITY];
+
+  // Simulation state
+  Simulation* _simulation;
+
+  // Particles to spawn (positive) or despawn (negative) before the next
+  // update, requested from the keyboard
+  std::atomic<int> _spawning;
+
+  // Snapshot requested from the keyboard, written before the next update
+  std::atomic<bool> _saving;
+
+  // Rendering state, double-buffered in pipelined mode: frame N is in
+  // _renderers[N % 2]
+  Renderer _renderers[2];
+
+  // Pipelined mode: last frame written by the simulation thread, and last
+  // frame displayed by the main thread
+  std::thread _simulationThread;
+  std::atomic<unsigned long> _published;
+  std::atomic<unsigned long> _displayed;
+  std::atomic<bool> _running;
 };
 
 #endif
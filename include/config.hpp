@@ -0,0 +1,250 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "constants.hpp"
+#include "impulses.hpp"
+#include "quadtree.hpp"
+#include "loose_quadtree.hpp"
+
+// How candidate pairs are found
+enum class BroadPhase {
+  // Particles sharing a leaf of the spatial index
+  Index,
+
+  // Particles overlapping on x, with sort-and-sweep
+  Sweep
+};
+
+// How colliding particles respond
+enum class Response {
+  // Both leave at BOUNCE_SPEED along the line joining their centers
+  Bounce,
+
+  // Impulses from their mass and velocity, summed over all contacts
+  Impulse
+};
+
+struct Config {
+  // Particles created at start
+  unsigned int entities;
+
+  // Threads used by the collision pass, 1 for the serial path
+  unsigned int threads;
+
+  // How particles are dispatched in the tree
+  Insertion insertion;
+
+  // How candidate pairs are found
+  BroadPhase broadPhase;
+
+  // Update the tree instead of rebuilding it at each frame
+  bool incremental;
+
+  // Number of elements splitting a leaf
+  unsigned int capacity;
+
+  // Number of elements under which sibling leaves merge, 0 for capacity/2
+  unsigned int merge;
+
+  // Depth at which leaves stop splitting
+  unsigned int maxDepth;
+
+  // Ratio between the loose and the tight side of the nodes, with the loose
+  // quadtree
+  float looseness;
+
+  // Tune the capacity from the measured build and collision times
+  bool autoCapacity;
+
+  // Output of the profiler trace
+  std::string trace;
+
+  // Simulate the next frame while the current one is rendered
+  bool pipeline;
+
+  // Track contacts across frames, and only respond when they begin
+  bool contacts;
+
+  // Find contacts along the motion of the particles during a step, not only
+  // at its end
+  bool continuous;
+
+  // How colliding particles respond
+  Response response;
+
+  // Ratio of the normal speed kept after a contact, with Response::Impulse
+  float restitution;
+
+  // Duration of a simulation step, in seconds
+  double timeStep;
+
+  // Steps run at most per rendered frame to catch up with real time
+  unsigned int maxSteps;
+
+  // Seed of the random particles, 0 for a seed from the clock
+  unsigned int seed;
+
+  // Where snapshots are written
+  std::string snapshot;
+
+  // Snapshot to replay without window, none if empty
+  std::string replay;
+
+  // Steps of a replay
+  unsigned int frames;
+
+  /**
+   * Constructor with default settings
+   */
+  Config():entities(NB_ENTITY), threads(1), insertion(Insertion::Point), broadPhase(BroadPhase::Index), incremental(false), capacity(MAX_ELEMENTS),
+    merge(0), maxDepth(MAX_DEPTH), looseness(LOOSENESS), autoCapacity(false), trace("trace.json"), pipeline(false), contacts(false),
+    continuous(false), response(Response::Impulse), restitution(RESTITUTION), timeStep(1.0 / FRAME_RATE), maxSteps(MAX_STEPS), seed(0), snapshot("snapshot.bin"), replay(), frames(100) {}
+
+  /**
+   * Read settings from the command line
+   * @param argument count
+   * @param argument values
+   * @return settings, defaults for missing arguments
+   */
+  static Config parse(int argc, char** argv) {
+    Config config;
+
+    for (int i=1; i<argc; i++) {
+      const char* arg = argv[i];
+      const char* value = i+1 < argc ? argv[i+1] : nullptr;
+
+      if (std::strcmp(arg, "--entities") == 0 && value != nullptr) {
+        config.entities = std::atoi(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--threads") == 0 && value != nullptr) {
+        config.threads = std::atoi(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--insertion") == 0 && value != nullptr) {
+        if (std::strcmp(value, "bounds") == 0)
+          config.insertion = Insertion::Bounds;
+        else if (std::strcmp(value, "point") == 0)
+          config.insertion = Insertion::Point;
+        else
+          std::cerr << "Unknown insertion mode: " << value << std::endl;
+        i++;
+      }
+      else if (std::strcmp(arg, "--broadphase") == 0 && value != nullptr) {
+        if (std::strcmp(value, "sweep") == 0)
+          config.broadPhase = BroadPhase::Sweep;
+        else if (std::strcmp(value, "index") == 0)
+          config.broadPhase = BroadPhase::Index;
+        else
+          std::cerr << "Unknown broad phase: " << value << std::endl;
+        i++;
+      }
+      else if (std::strcmp(arg, "--response") == 0 && value != nullptr) {
+        if (std::strcmp(value, "impulse") == 0)
+          config.response = Response::Impulse;
+        else if (std::strcmp(value, "bounce") == 0)
+          config.response = Response::Bounce;
+        else
+          std::cerr << "Unknown response: " << value << std::endl;
+        i++;
+      }
+      else if (std::strcmp(arg, "--restitution") == 0 && value != nullptr) {
+        config.restitution = std::atof(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--capacity") == 0 && value != nullptr) {
+        config.capacity = std::atoi(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--merge") == 0 && value != nullptr) {
+        config.merge = std::atoi(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--max-depth") == 0 && value != nullptr) {
+        config.maxDepth = std::atoi(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--looseness") == 0 && value != nullptr) {
+        config.looseness = std::atof(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--auto-capacity") == 0)
+        config.autoCapacity = true;
+      else if (std::strcmp(arg, "--rate") == 0 && value != nullptr) {
+        config.timeStep = 1.0 / std::max(1, std::atoi(value));
+        i++;
+      }
+      else if (std::strcmp(arg, "--max-steps") == 0 && value != nullptr) {
+        config.maxSteps = std::max(1, std::atoi(value));
+        i++;
+      }
+      else if (std::strcmp(arg, "--seed") == 0 && value != nullptr) {
+        config.seed = std::strtoul(value, nullptr, 10);
+        i++;
+      }
+      else if (std::strcmp(arg, "--snapshot") == 0 && value != nullptr) {
+        config.snapshot = value;
+        i++;
+      }
+      else if (std::strcmp(arg, "--replay") == 0 && value != nullptr) {
+        config.replay = value;
+        i++;
+      }
+      else if (std::strcmp(arg, "--frames") == 0 && value != nullptr) {
+        config.frames = std::atoi(value);
+        i++;
+      }
+      else if (std::strcmp(arg, "--trace") == 0 && value != nullptr) {
+        config.trace = value;
+        i++;
+      }
+      else if (std::strcmp(arg, "--incremental") == 0)
+        config.incremental = true;
+      else if (std::strcmp(arg, "--pipeline") == 0)
+        config.pipeline = true;
+      else if (std::strcmp(arg, "--contacts") == 0)
+        config.contacts = true;
+      else if (std::strcmp(arg, "--ccd") == 0)
+        config.continuous = true;
+      else
+        std::cerr << "Ignoring unknown argument: " << arg << std::endl;
+    }
+
+    // 0 means one thread per core
+    if (config.threads == 0)
+      config.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    return config;
+  }
+};
+
+#endif
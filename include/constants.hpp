@@ -26,7 +26,15 @@ SOFTWARE. */
 #define WINDOW_WIDTH 1200
 #define WINDOW_HEIGHT 1200
 #define NB_ENTITY 10000
+#define SPAWN_BATCH 1000
+#define ENTITY_RADIUS 1
+#define FRAME_RATE 30
+#define BOUNCE_SPEED 300
+#define MAX_STEPS 4
+#define LEAVES_PER_TASK 16
+#define PARTICLES_PER_TASK 512
 #define STARTING_OFFSET sf::Vector2f(600, 600)
+#define OVERLAY_FONT "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"
 #define BETWEEN(X, A, B) ((X>=A) && (X<B))
 
 #endif
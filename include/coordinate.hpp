@@ -0,0 +1,82 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef COORDINATE_HPP
+#define COORDINATE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Fractional bits of fixed-point coordinates: steps of 1/256 unit, over
+// +/-8388608 units
+#define FIXED_BITS 8
+
+/**
+ * 32-bit fixed-point coordinate. Unlike a float, its precision does not
+ * depend on the distance to the origin, and halving a length is exact down
+ * to a single step.
+ */
+struct Fixed {
+  std::int32_t raw;
+
+  Fixed():raw(0) {}
+
+  /**
+   * Conversion from world units, rounded down and clamped to the range
+   * @param value
+   */
+  explicit Fixed(float value) {
+    const float scaled = std::floor(value * (1 << FIXED_BITS));
+
+    // Largest float below 2^31
+    const float limit = 2147483520.0f;
+    raw = std::int32_t(std::min(std::max(scaled, -limit), limit));
+  }
+
+  /**
+   * Conversion to world units
+   */
+  explicit operator float() const {
+    return raw / float(1 << FIXED_BITS);
+  }
+
+  inline Fixed operator+(Fixed f) const { return _make(raw + f.raw); }
+  inline Fixed operator-(Fixed f) const { return _make(raw - f.raw); }
+  inline Fixed operator/(int d) const { return _make(raw / d); }
+
+  inline bool operator<(Fixed f) const { return raw < f.raw; }
+  inline bool operator<=(Fixed f) const { return raw <= f.raw; }
+  inline bool operator>(Fixed f) const { return raw > f.raw; }
+  inline bool operator>=(Fixed f) const { return raw >= f.raw; }
+  inline bool operator==(Fixed f) const { return raw == f.raw; }
+
+private:
+  static inline Fixed _make(std::int32_t raw) {
+    Fixed f;
+    f.raw = raw;
+    return f;
+  }
+};
+
+#endif
@@ -0,0 +1,323 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "quadtree.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+/**
+ * Uniform grid over the playable area, with the same interface as the
+ * quadtrees (see spatial_index.hpp): cells play the role of leaves.
+ * The cell size follows the density, so that cells hold about as many
+ * elements as a full quadtree leaf.
+ */
+class Grid {
+  using Position = sf::Vector2f;
+  using Rectangle = sf::Rect<int>;
+  using EntityId = unsigned int;
+
+public:
+  using Leaf = std::uint32_t;
+
+  /**
+   * Constructor
+   * @param area covered by the grid, positions outside go to border cells
+   */
+  Grid(const Rectangle& r):
+    _area(r), _cells(), _occupied(), _insertion(Insertion::Point), _capacity(MAX_ELEMENTS),
+    _cellSize(0), _inverse(0), _columns(0), _rows(0) {
+    _resize(1);
+  }
+
+  /**
+   * Add an element in the grid
+   * @template type of elements referenced in the grid
+   * @entities the external container storing all objects
+   * @param index of object to add in grid
+   */
+  template<typename T>
+  void add(const T& entities, EntityId id) {
+    const Position p = entities[id].getPosition();
+
+    if (_insertion == Insertion::Point) {
+      _store(_column(p.x) + _row(p.y) * _columns, id);
+      return;
+    }
+
+    // In every cell overlapped by the bounding box
+    const float r = entities[id].getRadius();
+    const unsigned int left = _column(p.x - r), right = _column(p.x + r);
+    const unsigned int top = _row(p.y - r), bottom = _row(p.y + r);
+
+    for (unsigned int y=top; y<=bottom; y++)
+      for (unsigned int x=left; x<=right; x++)
+        _store(x + y * _columns, id);
+  }
+
+  /**
+   * Rebuild the grid, sized for the number of elements
+   * @template type of elements referenced in the grid
+   * @entities the external container storing all objects
+   * @param number of elements, indexed from 0
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count) {
+    clear();
+    _resize(count);
+
+    for (EntityId id=0; id<count; id++)
+      add(entities, id);
+  }
+
+  /**
+   * Rebuild the whole grid: the build is serial
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count, Workers&) {
+    build(entities, count);
+  }
+
+  /**
+   * Update the grid after elements moved: a rebuild, cheap for a grid
+   * @return number of elements inserted
+   */
+  template<typename T>
+  unsigned int update(const T& entities, unsigned int count) {
+    build(entities, count);
+    return count;
+  }
+
+  /**
+   * Remove an element: nothing to do, as update() rebuilds the grid
+   */
+  void erase(EntityId, EntityId) {}
+
+  /**
+   * Find the cell containing a position
+   * @param position, clamped to the grid
+   * @return the cell index
+   */
+  Leaf locate(const Position& p) const {
+    return _column(p.x) + _row(p.y) * _columns;
+  }
+
+  /**
+   * Visit the cells overlapping a rectangle, borders included
+   * @param rectangle
+   * @param function called with each cell
+   */
+  template<typename F>
+  void forEachLeaf(const sf::FloatRect& r, const F& f) const {
+    const unsigned int right = _column(r.left + r.width);
+    const unsigned int bottom = _row(r.top + r.height);
+
+    for (unsigned int y=_row(r.top); y<=bottom; y++)
+      for (unsigned int x=_column(r.left); x<=right; x++)
+        f(Leaf(x + y * _columns));
+  }
+
+  /**
+   * Choose how elements are dispatched, before building the grid.
+   * With Insertion::Bounds, elements must provide getRadius().
+   * @param insertion mode
+   */
+  void setInsertion(Insertion insertion) {
+    _insertion = insertion;
+  }
+
+  /**
+   * Getter for the insertion mode
+   */
+  inline Insertion getInsertion() const {
+    return _insertion;
+  }
+
+  /**
+   * Set the average number of elements per cell, before building the grid
+   * @param cell capacity, at least 1
+   */
+  void setCapacity(unsigned int capacity) {
+    _capacity = std::max(1u, capacity);
+    clear();
+  }
+
+  /**
+   * Merge threshold, unused: a grid is rebuilt at each update
+   */
+  void setMergeThreshold(unsigned int) {}
+
+  /**
+   * Maximum depth, unused: a grid is a single level
+   */
+  void setMaxDepth(unsigned int) {}
+
+  /**
+   * Looseness, unused: cells have tight bounds
+   */
+  void setLooseness(float) {}
+
+  /**
+   * Elements of other cells to test against the elements of a cell: none,
+   * as pairs never span cells
+   * @return 0
+   */
+  unsigned int getNeighbors(Leaf, std::vector<unsigned int>*) const {
+    return 0;
+  }
+
+  /**
+   * Fill an array with the non-empty cells
+   * @param output array
+   */
+  void getLeaves(std::vector<Leaf>* out) const {
+    out->insert(out->end(), _occupied.begin(), _occupied.end());
+  }
+
+  /**
+   * Getter for cell elements
+   * @param cell index
+   * @param output array
+   * @return the output size
+   */
+  unsigned int getElements(Leaf leaf, unsigned int** data) {
+    *data = _cells[leaf].data();
+    return _cells[leaf].size();
+  }
+
+  /**
+   * Drawing function: append non-empty cells to batched vertex arrays
+   * @param line list receiving cell outlines
+   * @param quad list receiving cell fillings
+   */
+  void draw(sf::VertexArray* lines, sf::VertexArray* quads) const {
+    for (auto cell: _occupied)
+      Utils::rectangle(lines, quads,
+                       sf::FloatRect(_area.left + (cell % _columns) * _cellSize,
+                                     _area.top + (cell / _columns) * _cellSize, _cellSize, _cellSize),
+                       sf::Color::Blue, sf::Color(0x00,0x33,0xCC,0x33));
+  }
+
+  /**
+   * Empty all cells, keeping their capacity
+   */
+  void clear() {
+    for (auto cell: _occupied)
+      _cells[cell].clear();
+    _occupied.clear();
+  }
+
+  /**
+   * Getter for the number of cells
+   */
+  inline unsigned int size() const {
+    return _cells.size();
+  }
+
+  /**
+   * Depth of the structure, for statistics shared with the trees
+   * @return 0, a grid is a single level
+   */
+  inline unsigned int depth() const {
+    return 0;
+  }
+
+private:
+  Rectangle _area;
+
+  // Elements of each cell, row by row
+  std::vector<std::vector<EntityId>> _cells;
+
+  // Non-empty cells
+  std::vector<Leaf> _occupied;
+
+  // How elements are dispatched
+  Insertion _insertion;
+
+  // Average number of elements per cell
+  unsigned int _capacity;
+
+  // Cell side in pixels, and its inverse
+  float _cellSize;
+  float _inverse;
+  unsigned int _columns;
+  unsigned int _rows;
+
+  /**
+   * Column of an abscissa, clamped to the grid
+   */
+  inline unsigned int _column(float x) const {
+    const float c = (x - _area.left) * _inverse;
+    return c <= 0 ? 0 : std::min(unsigned(c), _columns - 1);
+  }
+
+  /**
+   * Row of an ordinate, clamped to the grid
+   */
+  inline unsigned int _row(float y) const {
+    const float c = (y - _area.top) * _inverse;
+    return c <= 0 ? 0 : std::min(unsigned(c), _rows - 1);
+  }
+
+  /**
+   * Append an element to a cell
+   * @param cell index
+   * @param element index
+   */
+  inline void _store(Leaf cell, EntityId id) {
+    if (_cells[cell].empty())
+      _occupied.push_back(cell);
+    _cells[cell].push_back(id);
+  }
+
+  /**
+   * Choose the cell size from the density: area * capacity / count per cell.
+   * Cells are only reallocated when the grid dimensions change.
+   * @param number of elements
+   */
+  void _resize(unsigned int count) {
+    const float area = float(_area.width) * _area.height;
+    const float size = std::max<float>(MIN_NODE_SIZE, std::sqrt(area * _capacity / std::max(1u, count)));
+    const unsigned int columns = std::max(1, int(std::ceil(_area.width / size)));
+    const unsigned int rows = std::max(1, int(std::ceil(_area.height / size)));
+
+    _cellSize = size;
+    _inverse = 1 / size;
+
+    if (columns != _columns || rows != _rows) {
+      _columns = columns;
+      _rows = rows;
+      _cells.assign(columns * rows, std::vector<EntityId>());
+      _occupied.clear();
+    }
+  }
+};
+
+#endif
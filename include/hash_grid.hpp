@@ -0,0 +1,373 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef HASH_GRID_HPP
+#define HASH_GRID_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "quadtree.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Number of cells under which a query tells visited buckets apart on the stack
+#define HASH_GRID_QUERY_CELLS 64
+
+/**
+ * Unbounded grid: cells are hashed into a table of buckets sized for the
+ * number of elements, so memory does not depend on the world extent.
+ * Same interface as the quadtrees (see spatial_index.hpp): buckets play the
+ * role of leaves. Two cells may share a bucket, which only adds candidate
+ * pairs for the narrow phase to reject.
+ */
+class HashGrid {
+  using Position = sf::Vector2f;
+  using Rectangle = sf::Rect<int>;
+  using EntityId = unsigned int;
+
+public:
+  using Leaf = std::uint32_t;
+
+  /**
+   * Constructor
+   * @param reference area, only used to size cells from the density
+   */
+  HashGrid(const Rectangle& r):
+    _area(r), _buckets(), _occupied(), _cells(),
+    _insertion(Insertion::Point), _capacity(MAX_ELEMENTS), _cellSize(0), _inverse(0), _mask(0) {
+    _resize(1);
+  }
+
+  /**
+   * Add an element in the grid
+   * @template type of elements referenced in the grid
+   * @entities the external container storing all objects
+   * @param index of object to add in grid
+   */
+  template<typename T>
+  void add(const T& entities, EntityId id) {
+    const Position p = entities[id].getPosition();
+
+    if (_insertion == Insertion::Point) {
+      _store(_cell(p.x), _cell(p.y), id);
+      return;
+    }
+
+    // In the bucket of every cell overlapped by the bounding box
+    const float r = entities[id].getRadius();
+    const int right = _cell(p.x + r);
+    const int bottom = _cell(p.y + r);
+
+    for (int y=_cell(p.y - r); y<=bottom; y++)
+      for (int x=_cell(p.x - r); x<=right; x++)
+        _store(x, y, id);
+  }
+
+  /**
+   * Rebuild the grid, sized for the number of elements
+   * @template type of elements referenced in the grid
+   * @entities the external container storing all objects
+   * @param number of elements, indexed from 0
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count) {
+    clear();
+    _resize(count);
+
+    for (EntityId id=0; id<count; id++)
+      add(entities, id);
+  }
+
+  /**
+   * Rebuild the whole grid: the build is serial
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count, Workers&) {
+    build(entities, count);
+  }
+
+  /**
+   * Update the grid after elements moved: a rebuild, cheap for a grid
+   * @return number of elements inserted
+   */
+  template<typename T>
+  unsigned int update(const T& entities, unsigned int count) {
+    build(entities, count);
+    return count;
+  }
+
+  /**
+   * Remove an element: nothing to do, as update() rebuilds the grid
+   */
+  void erase(EntityId, EntityId) {}
+
+  /**
+   * Find the bucket of the cell containing a position
+   * @param position, anywhere
+   * @return the bucket index
+   */
+  Leaf locate(const Position& p) const {
+    return _hash(_cell(p.x), _cell(p.y));
+  }
+
+  /**
+   * Visit the buckets of the cells overlapping a rectangle, borders
+   * included, each bucket once. Visited buckets are kept by the call, so
+   * concurrent queries are safe.
+   * @param rectangle
+   * @param function called with each bucket
+   */
+  template<typename F>
+  void forEachLeaf(const sf::FloatRect& r, const F& f) const {
+    const int left = _cell(r.left);
+    const int top = _cell(r.top);
+    const int right = _cell(r.left + r.width);
+    const int bottom = _cell(r.top + r.height);
+
+    // Small queries compare with the few buckets already visited
+    if (double(right - left + 1) * (bottom - top + 1) <= HASH_GRID_QUERY_CELLS) {
+      Leaf visited[HASH_GRID_QUERY_CELLS];
+      unsigned int count = 0;
+
+      for (int y=top; y<=bottom; y++)
+        for (int x=left; x<=right; x++) {
+          const Leaf bucket = _hash(x, y);
+
+          if (std::find(visited, visited + count, bucket) == visited + count) {
+            visited[count++] = bucket;
+            f(bucket);
+          }
+        }
+      return;
+    }
+
+    std::vector<bool> visited(_mask + 1, false);
+    for (int y=top; y<=bottom; y++)
+      for (int x=left; x<=right; x++) {
+        const Leaf bucket = _hash(x, y);
+
+        if (not visited[bucket]) {
+          visited[bucket] = true;
+          f(bucket);
+        }
+      }
+  }
+
+  /**
+   * Choose how elements are dispatched, before building the grid.
+   * With Insertion::Bounds, elements must provide getRadius().
+   * @param insertion mode
+   */
+  void setInsertion(Insertion insertion) {
+    _insertion = insertion;
+  }
+
+  /**
+   * Getter for the insertion mode
+   */
+  inline Insertion getInsertion() const {
+    return _insertion;
+  }
+
+  /**
+   * Set the average number of elements per cell, before building the grid
+   * @param cell capacity, at least 1
+   */
+  void setCapacity(unsigned int capacity) {
+    _capacity = std::max(1u, capacity);
+    clear();
+  }
+
+  /**
+   * Merge threshold, unused: a grid is rebuilt at each update
+   */
+  void setMergeThreshold(unsigned int) {}
+
+  /**
+   * Maximum depth, unused: a grid is a single level
+   */
+  void setMaxDepth(unsigned int) {}
+
+  /**
+   * Looseness, unused: cells have tight bounds
+   */
+  void setLooseness(float) {}
+
+  /**
+   * Elements of other buckets to test against the elements of a bucket:
+   * none, as pairs never span buckets
+   * @return 0
+   */
+  unsigned int getNeighbors(Leaf, std::vector<unsigned int>*) const {
+    return 0;
+  }
+
+  /**
+   * Fill an array with the non-empty buckets
+   * @param output array
+   */
+  void getLeaves(std::vector<Leaf>* out) const {
+    out->insert(out->end(), _occupied.begin(), _occupied.end());
+  }
+
+  /**
+   * Getter for bucket elements
+   * @param bucket index
+   * @param output array
+   * @return the output size
+   */
+  unsigned int getElements(Leaf leaf, unsigned int** data) {
+    *data = _buckets[leaf].data();
+    return _buckets[leaf].size();
+  }
+
+  /**
+   * Drawing function: append non-empty cells to batched vertex arrays.
+   * Only the first cell of each bucket is drawn.
+   * @param line list receiving cell outlines
+   * @param quad list receiving cell fillings
+   */
+  void draw(sf::VertexArray* lines, sf::VertexArray* quads) const {
+    for (auto cell: _cells)
+      Utils::rectangle(lines, quads,
+                       sf::FloatRect(std::int32_t(cell >> 32) * _cellSize, std::int32_t(cell) * _cellSize,
+                                     _cellSize, _cellSize),
+                       sf::Color::Blue, sf::Color(0x00,0x33,0xCC,0x33));
+  }
+
+  /**
+   * Empty all buckets, keeping their capacity
+   */
+  void clear() {
+    for (auto bucket: _occupied)
+      _buckets[bucket].clear();
+    _occupied.clear();
+    _cells.clear();
+  }
+
+  /**
+   * Getter for the number of buckets
+   */
+  inline unsigned int size() const {
+    return _buckets.size();
+  }
+
+  /**
+   * Depth of the structure, for statistics shared with the trees
+   * @return 0, a grid is a single level
+   */
+  inline unsigned int depth() const {
+    return 0;
+  }
+
+private:
+  // Reference area for the density
+  Rectangle _area;
+
+  // Elements of each bucket
+  std::vector<std::vector<EntityId>> _buckets;
+
+  // Non-empty buckets
+  std::vector<Leaf> _occupied;
+
+  // Coordinates of the first cell which filled each bucket, for draw()
+  std::vector<std::uint64_t> _cells;
+
+  // How elements are dispatched
+  Insertion _insertion;
+
+  // Average number of elements per cell
+  unsigned int _capacity;
+
+  // Cell side in pixels, and its inverse
+  float _cellSize;
+  float _inverse;
+
+  // Number of buckets minus one, a power of 2 minus one
+  std::uint32_t _mask;
+
+  /**
+   * Cell coordinate of a position coordinate, negative ones included
+   */
+  inline int _cell(float v) const {
+    return int(std::floor(v * _inverse));
+  }
+
+  /**
+   * Bucket of a cell
+   */
+  inline Leaf _hash(int x, int y) const {
+    return ((std::uint32_t(x) * 73856093u) ^ (std::uint32_t(y) * 19349663u)) & _mask;
+  }
+
+  /**
+   * Append an element to the bucket of a cell
+   * @param cell column
+   * @param cell row
+   * @param element index
+   */
+  inline void _store(int x, int y, EntityId id) {
+    const Leaf bucket = _hash(x, y);
+    std::vector<EntityId>& elements = _buckets[bucket];
+
+    // Once per bucket, even if several cells of the element share it
+    if (not elements.empty() && elements.back() == id)
+      return;
+
+    if (elements.empty()) {
+      _occupied.push_back(bucket);
+      _cells.push_back(std::uint64_t(std::uint32_t(x)) << 32 | std::uint32_t(y));
+    }
+
+    elements.push_back(id);
+  }
+
+  /**
+   * Choose the cell size from the density of the reference area, and about
+   * two buckets per non-empty cell. Buckets are only reallocated when their
+   * number changes.
+   * @param number of elements
+   */
+  void _resize(unsigned int count) {
+    const float area = float(_area.width) * _area.height;
+    const float size = std::max<float>(MIN_NODE_SIZE, std::sqrt(area * _capacity / std::max(1u, count)));
+
+    _cellSize = size;
+    _inverse = 1 / size;
+
+    std::uint32_t buckets = 1;
+    while (buckets < 2 * std::max(1u, count / _capacity))
+      buckets *= 2;
+
+    if (buckets != _mask + 1 || _buckets.empty()) {
+      _mask = buckets - 1;
+      _buckets.assign(buckets, std::vector<EntityId>());
+      _occupied.clear();
+    }
+  }
+};
+
+#endif
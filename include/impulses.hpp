@@ -0,0 +1,134 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef IMPULSES_HPP
+#define IMPULSES_HPP
+
+#include <cstdint>
+#include <vector>
+#include "particles.hpp"
+
+// Default ratio of the normal speed kept after a contact, 1 for elastic
+#define RESTITUTION 1.0f
+
+// Share of the overlap corrected in one step, and overlap left uncorrected
+// so that resting contacts do not jitter
+#define CORRECTION_RATE 0.8f
+#define CORRECTION_SLOP 0.01f
+
+/**
+ * Physically based collision response. Particles are discs of uniform
+ * density: their mass grows with the square of their radius. Each contact
+ * gives both particles an impulse along the line joining their centers,
+ * and pushes them apart in proportion to their inverse mass.
+ * Impulses are computed from the state at the start of the collision pass,
+ * buffered, then summed per particle and applied at once: the outcome does
+ * not depend on the order of the contacts, and a later contact does not
+ * erase an earlier one. As the contacts of a particle are solved
+ * independently, each one is scaled down by the contact count of the
+ * busier particle, so that piles do not gain energy.
+ */
+class Impulses {
+  using EntityId = unsigned int;
+
+public:
+  /**
+   * Constructor
+   */
+  Impulses():_contacts(), _counts(), _restitution(RESTITUTION) {}
+
+  /**
+   * Set the ratio of the normal speed kept after a contact
+   * @param restitution, 0 for inelastic contacts and 1 for elastic ones
+   */
+  inline void setRestitution(float restitution) {
+    _restitution = restitution;
+  }
+
+  /**
+   * Start a collision pass, with no impulse
+   * @param number of particles
+   */
+  void reset(unsigned int count);
+
+  /**
+   * Record the response to a contact, without changing the particles
+   * @param particles
+   * @param a particle
+   * @param another particle
+   */
+  void add(const Particles& particles, EntityId i, EntityId j);
+
+  /**
+   * Apply the impulses and corrections recorded since reset()
+   * @param particles
+   */
+  void apply(Particles* particles);
+
+  /**
+   * Respond to a single contact right away, for contacts resolved one by
+   * one (continuous collision detection)
+   * @param particles
+   * @param a particle
+   * @param another particle
+   */
+  void resolve(Particles* particles, EntityId i, EntityId j) const;
+
+private:
+  /**
+   * Response to a contact
+   * @param particles
+   * @param a particle
+   * @param another particle
+   * @param output change of velocity of j, the opposite for i once scaled
+   * by their inverse mass
+   * @param output correction of position, scaled the same way
+   * @return false if the particles are at the same position
+   */
+  bool _response(const Particles& particles, EntityId i, EntityId j, sf::Vector2f* impulse,
+                 sf::Vector2f* correction) const;
+
+  /**
+   * Inverse mass of a particle
+   */
+  static inline float _inverseMass(const Particles& particles, EntityId id) {
+    return 1 / (particles.radius[id] * particles.radius[id]);
+  }
+
+  // Response to a contact, before scaling
+  struct Contact {
+    EntityId i;
+    EntityId j;
+    sf::Vector2f impulse;
+    sf::Vector2f correction;
+  };
+
+  std::vector<Contact> _contacts;
+
+  // Number of contacts of each particle
+  std::vector<std::uint32_t> _counts;
+
+  float _restitution;
+};
+
+#endif
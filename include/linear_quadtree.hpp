@@ -0,0 +1,615 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef LINEAR_QUADTREE_HPP
+#define LINEAR_QUADTREE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "quadtree.hpp"
+#include "morton.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Resolution of Morton codes: the deepest possible leaves
+#define LINEAR_MAX_DEPTH 16
+
+// Child order, as a 2-bit index: bit 0 is east, bit 1 is south
+#define LINEAR_NORTH_WEST 0
+#define LINEAR_NORTH_EAST 1
+#define LINEAR_SOUTH_WEST 2
+#define LINEAR_SOUTH_EAST 3
+
+/**
+ * Quadtree stored in a single array.
+ * The 4 children of a node are contiguous and addressed by the index of the
+ * first one, leaves reference a block of a shared element buffer, and node
+ * bounds are recomputed from the root area while descending.
+ */
+class LinearQuadtree {
+  using Position = sf::Vector2f;
+  using Rectangle = sf::Rect<int>;
+  using EntityId = unsigned int;
+
+public:
+  using Leaf = std::uint32_t;
+
+  /**
+   * Constructor
+   * @param screen area associated to the root
+   */
+  LinearQuadtree(const Rectangle& r):
+    _nodes(), _elements(), _keys(), _scratch(), _insertion(Insertion::Point), _capacity(MAX_ELEMENTS),
+    _maxDepth(std::min(MAX_DEPTH, LINEAR_MAX_DEPTH)),
+    _x(r.left), _y(r.top), _width(r.width), _height(r.height),
+    _scaleX(MORTON_CELLS / r.width), _scaleY(MORTON_CELLS / r.height) {
+    clear();
+  }
+
+  /**
+   * Add an element in the tree
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param index of object to add in tree
+   */
+  template<typename T>
+  void add(const T& entities, EntityId id) {
+    _insert(entities, id, Bounds{0, 0, 0, 0, _x, _y, _width, _height});
+  }
+
+  /**
+   * Rebuild the whole tree from scratch.
+   * Elements are sorted by Morton code, then leaves are emitted in a single
+   * pass over the sorted codes: the elements of a leaf are contiguous in
+   * the element buffer, and leaves come in Z-order.
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param number of objects
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count) {
+    // Elements with a size may belong to several leaves
+    if (_insertion == Insertion::Bounds) {
+      clear();
+      for (EntityId id=0; id<count; id++)
+        add(entities, id);
+      return;
+    }
+
+    _keys.resize(count);
+    for (EntityId id=0; id<count; id++) {
+      const Position p = entities[id].getPosition();
+      _keys[id] = (std::uint64_t(Morton::encode(_gridX(p.x), _gridY(p.y))) << 32) | id;
+    }
+
+    Morton::sort(_keys, _scratch);
+
+    _elements.resize(count);
+    for (unsigned int i=0; i<count; i++)
+      _elements[i] = std::uint32_t(_keys[i]);
+
+    _nodes.clear();
+    _nodes.push_back(Cell{NO_CHILD, 0, 0, 0});
+    _emit(0, 0, 0, count);
+  }
+
+  /**
+   * Rebuild the whole tree: the bulk build is serial
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count, Workers&) {
+    build(entities, count);
+  }
+
+  /**
+   * Update the tree after elements have moved.
+   * There is no incremental mode for this layout: the bulk build is cheaper
+   * than tracking the leaf of every element.
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param number of objects
+   * @return number of re-inserted objects
+   */
+  template<typename T>
+  unsigned int update(const T& entities, unsigned int count) {
+    build(entities, count);
+    return count;
+  }
+
+  /**
+   * Remove an element, following a swap-and-pop of the external container.
+   * Nothing to do, as update() rebuilds the tree.
+   * @param removed element index
+   * @param index of the last element before the removal
+   */
+  void erase(EntityId, EntityId) {}
+
+  /**
+   * Find the leaf containing a position
+   * @param position
+   * @return the leaf index
+   */
+  Leaf locate(const Position& p) const {
+    Bounds b{0, 0, 0, 0, _x, _y, _width, _height};
+    const std::uint32_t x = _gridX(p.x);
+    const std::uint32_t y = _gridY(p.y);
+
+    while (_nodes[b.index].firstChild != NO_CHILD)
+      b = b.child(_nodes[b.index].firstChild, _quadrant(b, x, y));
+
+    return b.index;
+  }
+
+  /**
+   * Choose how elements are dispatched, before building the tree.
+   * With Insertion::Bounds, elements must provide getRadius() and build()
+   * falls back to insertions.
+   * @param insertion mode
+   */
+  void setInsertion(Insertion insertion) {
+    _insertion = insertion;
+  }
+
+  /**
+   * Getter for the insertion mode
+   */
+  inline Insertion getInsertion() const {
+    return _insertion;
+  }
+
+  /**
+   * Set the number of elements splitting a leaf, before building the tree
+   * @param leaf capacity, at least 1
+   */
+  void setCapacity(unsigned int capacity) {
+    _capacity = std::max(1u, capacity);
+    clear();
+  }
+
+  /**
+   * Merge threshold, unused: leaves are never merged as update() rebuilds
+   */
+  void setMergeThreshold(unsigned int) {}
+
+  /**
+   * Set the depth at which leaves stop splitting, before building the tree
+   * @param maximum depth, at most LINEAR_MAX_DEPTH
+   */
+  void setMaxDepth(unsigned int depth) {
+    _maxDepth = std::min<unsigned int>(depth, LINEAR_MAX_DEPTH);
+    clear();
+  }
+
+  /**
+   * Looseness, unused: nodes have tight bounds
+   */
+  void setLooseness(float) {}
+
+  /**
+   * Elements of other leaves to test against the elements of a leaf: none,
+   * as pairs never span leaves
+   * @return 0
+   */
+  unsigned int getNeighbors(Leaf, std::vector<unsigned int>*) const {
+    return 0;
+  }
+
+  /**
+   * Visit the leaves overlapping a rectangle, borders included. As for
+   * positions, the rectangle is clamped to the root.
+   * @param rectangle
+   * @param function called with each leaf
+   */
+  template<typename F>
+  void forEachLeaf(const sf::FloatRect& r, const F& f) const {
+    _forEachLeaf(r, f, Bounds{0, 0, 0, 0, _x, _y, _width, _height});
+  }
+
+  /**
+   * Fill an array with all the tree leaves
+   * @param output array
+   */
+  void getLeaves(std::vector<Leaf>* out) const {
+    // Nodes are contiguous, so this is a linear scan
+    for (Leaf i=0; i<_nodes.size(); i++)
+      if (_nodes[i].firstChild == NO_CHILD)
+        out->push_back(i);
+  }
+
+  /**
+   * Getter for leaf elements
+   * @param leaf index
+   * @param output array
+   * @return the output size
+   */
+  unsigned int getElements(Leaf leaf, unsigned int** data) {
+    const Cell& cell = _nodes[leaf];
+    *data = _elements.data() + cell.first;
+    return cell.count;
+  }
+
+  /**
+   * Drawing function: append non-empty leaves to batched vertex arrays
+   * @param line list receiving leaf outlines
+   * @param quad list receiving leaf fillings
+   */
+  void draw(sf::VertexArray* lines, sf::VertexArray* quads) const {
+    _draw(lines, quads, Bounds{0, 0, 0, 0, _x, _y, _width, _height});
+  }
+
+  /**
+   * Clear the tree, keeping buffers capacity
+   */
+  void clear() {
+    _nodes.clear();
+    _elements.clear();
+    _nodes.push_back(_leaf());
+  }
+
+  /**
+   * Getter for the number of nodes
+   * @return nodes in the tree, including the root
+   */
+  inline unsigned int size() const {
+    return _nodes.size();
+  }
+
+  /**
+   * Compute the depth of the tree
+   * @return 0 if the root is a leaf
+   */
+  unsigned int depth() const {
+    return _depth(0);
+  }
+
+private:
+  // Index 0 is the root, which is never a child
+  static constexpr std::uint32_t NO_CHILD = 0;
+
+  struct Cell {
+    // Index of the north-west child, or NO_CHILD for a leaf
+    std::uint32_t firstChild;
+
+    // Block of the element buffer owned by a leaf
+    std::uint32_t first;
+    std::uint32_t count;
+    std::uint32_t capacity;
+  };
+
+  // Node being visited, with its bounds computed on the fly: the corner on
+  // the Morton grid, which dispatches elements, and the area, which is drawn
+  struct Bounds {
+    std::uint32_t index;
+    std::uint32_t depth;
+    std::uint32_t gridX, gridY;
+    float x, y, width, height;
+
+    inline Bounds child(std::uint32_t firstChild, unsigned int quadrant) const {
+      std::uint32_t cells = half();
+      float w = width/2;
+      float h = height/2;
+      return Bounds{firstChild + quadrant, depth + 1,
+                    gridX + ((quadrant & 1) ? cells : 0), gridY + ((quadrant & 2) ? cells : 0),
+                    x + ((quadrant & 1) ? w : 0), y + ((quadrant & 2) ? h : 0),
+                    w, h};
+    }
+
+    // Side of the children on the Morton grid
+    inline std::uint32_t half() const {
+      return 1u << (LINEAR_MAX_DEPTH - 1 - depth);
+    }
+  };
+
+  // All nodes
+  std::vector<Cell> _nodes;
+
+  // Elements of all leaves
+  std::vector<EntityId> _elements;
+
+  // Sort buffers of build(), kept between frames
+  std::vector<std::uint64_t> _keys;
+  std::vector<std::uint64_t> _scratch;
+
+  // How elements are dispatched
+  Insertion _insertion;
+
+  // Number of elements splitting a leaf
+  std::uint32_t _capacity;
+
+  // Depth of the deepest leaves
+  std::uint32_t _maxDepth;
+
+  // Root area
+  float _x, _y, _width, _height;
+
+  // Morton grid cells per unit of length
+  float _scaleX, _scaleY;
+
+  // Morton grid resolution on each axis, one cell per leaf at maximum depth
+  static constexpr float MORTON_CELLS = 1 << LINEAR_MAX_DEPTH;
+
+  /**
+   * Clamp a scaled coordinate to the Morton grid
+   */
+  static inline std::uint32_t _quantize(float v) {
+    return v <= 0 ? 0 : v >= MORTON_CELLS ? (1 << LINEAR_MAX_DEPTH) - 1 : std::uint32_t(v);
+  }
+
+  /**
+   * Column of the Morton grid containing an abscissa. Keys, descents and
+   * queries all go through the grid, so they agree on node borders.
+   */
+  inline std::uint32_t _gridX(float x) const {
+    return _quantize((x - _x) * _scaleX);
+  }
+
+  /**
+   * Row of the Morton grid containing an ordinate
+   */
+  inline std::uint32_t _gridY(float y) const {
+    return _quantize((y - _y) * _scaleY);
+  }
+
+  /**
+   * Create the subtree of a node from a range of sorted keys
+   * @param node index
+   * @param node depth
+   * @param first key of the node
+   * @param last key of the node (excluded)
+   */
+  void _emit(std::uint32_t node, unsigned int depth, std::uint32_t begin, std::uint32_t end) {
+    if (end - begin < _capacity || depth >= _maxDepth) {
+      _nodes[node] = Cell{NO_CHILD, begin, end - begin, end - begin};
+      return;
+    }
+
+    std::uint32_t firstChild = _nodes.size();
+    _nodes[node] = Cell{firstChild, 0, 0, 0};
+    _nodes.resize(firstChild + NB_SUBNODES);
+
+    // Keys of each quadrant are contiguous
+    for (unsigned int quadrant=0; quadrant<NB_SUBNODES; quadrant++) {
+      auto last = std::partition_point(_keys.begin() + begin, _keys.begin() + end,
+        [=](std::uint64_t key) {
+          return Morton::quadrant(key >> 32, depth) <= quadrant;
+        });
+      std::uint32_t next = last - _keys.begin();
+
+      _emit(firstChild + quadrant, depth + 1, begin, next);
+      begin = next;
+    }
+  }
+
+  /**
+   * Create an empty leaf and reserve its element block
+   * @param block capacity
+   */
+  Cell _leaf(std::uint32_t capacity = 0) {
+    if (capacity == 0)
+      capacity = _capacity;
+
+    std::uint32_t first = _elements.size();
+    _elements.resize(first + capacity);
+    return Cell{NO_CHILD, first, 0, capacity};
+  }
+
+  /**
+   * Descend from a node to the leaf containing an element and store it there
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param index of object to add in tree
+   * @param node to start from
+   */
+  template<typename T>
+  void _insert(const T& entities, EntityId id, Bounds b) {
+    const Position p = entities[id].getPosition();
+
+    if (_insertion == Insertion::Bounds) {
+      _insertBounds(entities, id, p, entities[id].getRadius(), b);
+      return;
+    }
+
+    // Child selection from the node center, no rectangle test
+    const std::uint32_t x = _gridX(p.x);
+    const std::uint32_t y = _gridY(p.y);
+    while (_nodes[b.index].firstChild != NO_CHILD)
+      b = b.child(_nodes[b.index].firstChild, _quadrant(b, x, y));
+
+    _store(entities, id, b);
+  }
+
+  /**
+   * Add an element in every leaf overlapped by its bounding box
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param index of object to add in tree
+   * @param box center
+   * @param box half size
+   * @param node to start from
+   */
+  template<typename T>
+  void _insertBounds(const T& entities, EntityId id, const Position& p, float r, const Bounds& b) {
+    std::uint32_t firstChild = _nodes[b.index].firstChild;
+
+    if (firstChild == NO_CHILD) {
+      _store(entities, id, b);
+      return;
+    }
+
+    // Same half-open convention as _quadrant()
+    const std::uint32_t cx = b.gridX + b.half();
+    const std::uint32_t cy = b.gridY + b.half();
+    const bool west = _gridX(p.x - r) < cx;
+    const bool east = _gridX(p.x + r) >= cx;
+    const bool north = _gridY(p.y - r) < cy;
+    const bool south = _gridY(p.y + r) >= cy;
+
+    for (unsigned int quadrant=0; quadrant<NB_SUBNODES; quadrant++)
+      if (((quadrant & 1) ? east : west) && ((quadrant & 2) ? south : north))
+        _insertBounds(entities, id, p, r, b.child(firstChild, quadrant));
+  }
+
+  /**
+   * Append an element to a leaf, and split the leaf if it is full
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param index of object to add in tree
+   * @param leaf
+   */
+  template<typename T>
+  void _store(const T& entities, EntityId id, const Bounds& b) {
+    if (_nodes[b.index].count == _nodes[b.index].capacity)
+      _grow(b.index);
+
+    Cell& cell = _nodes[b.index];
+    _elements[cell.first + cell.count++] = id;
+
+    // If there is too much objects in the same leaf, it is split in 4
+    if (cell.count >= _capacity && _canSplit(b))
+      _split(entities, b);
+  }
+
+  /**
+   * Child containing a cell of the Morton grid, from the node center: no
+   * rectangle test. This is the quadrant of the cell Morton code.
+   */
+  static inline unsigned int _quadrant(const Bounds& b, std::uint32_t x, std::uint32_t y) {
+    return (x >= b.gridX + b.half()) | ((y >= b.gridY + b.half()) << 1);
+  }
+
+  /**
+   * Return true if a leaf can be split
+   */
+  inline bool _canSplit(const Bounds& b) const {
+    if (b.depth >= _maxDepth)
+      return false;
+
+    // Duplicated elements would not get any sparser in smaller nodes
+    if (_insertion == Insertion::Bounds)
+      return b.width >= 2*MIN_NODE_SIZE && b.height >= 2*MIN_NODE_SIZE;
+
+    return true;
+  }
+
+  /**
+   * Split a leaf and re-dispatch its elements in its children
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param leaf to split
+   */
+  template<typename T>
+  void _split(const T& entities, const Bounds& b) {
+    // The block of the former leaf is left unused until next clear, so it
+    // can be read while children blocks are appended to the buffer
+    std::uint32_t first = _nodes[b.index].first;
+    std::uint32_t count = _nodes[b.index].count;
+
+    std::uint32_t firstChild = _nodes.size();
+    for (int i=0; i<NB_SUBNODES; i++)
+      _nodes.push_back(_leaf());
+
+    _nodes[b.index] = Cell{firstChild, 0, 0, 0};
+
+    for (std::uint32_t i=0; i<count; i++)
+      _insert(entities, _elements[first + i], b);
+  }
+
+  /**
+   * Move a full leaf block at the end of the buffer with twice its capacity
+   * @param leaf index
+   */
+  void _grow(std::uint32_t leaf) {
+    Cell cell = _nodes[leaf];
+    Cell grown = _leaf(std::max<std::uint32_t>(cell.capacity * 2, _capacity));
+
+    for (std::uint32_t i=0; i<cell.count; i++)
+      _elements[grown.first + i] = _elements[cell.first + i];
+
+    grown.count = cell.count;
+    _nodes[leaf] = grown;
+  }
+
+  /**
+   * Recursive subroutine of forEachLeaf()
+   * @param rectangle
+   * @param function called with each leaf
+   * @param node to start from
+   */
+  template<typename F>
+  void _forEachLeaf(const sf::FloatRect& r, const F& f, const Bounds& b) const {
+    std::uint32_t firstChild = _nodes[b.index].firstChild;
+
+    if (firstChild == NO_CHILD) {
+      f(Leaf(b.index));
+      return;
+    }
+
+    // Same half-open convention as _insertBounds()
+    const std::uint32_t cx = b.gridX + b.half();
+    const std::uint32_t cy = b.gridY + b.half();
+    const bool west = _gridX(r.left) < cx;
+    const bool east = _gridX(r.left + r.width) >= cx;
+    const bool north = _gridY(r.top) < cy;
+    const bool south = _gridY(r.top + r.height) >= cy;
+
+    for (unsigned int quadrant=0; quadrant<NB_SUBNODES; quadrant++)
+      if (((quadrant & 1) ? east : west) && ((quadrant & 2) ? south : north))
+        _forEachLeaf(r, f, b.child(firstChild, quadrant));
+  }
+
+  /**
+   * Recursive subroutine of depth()
+   * @param node index
+   */
+  unsigned int _depth(std::uint32_t node) const {
+    std::uint32_t firstChild = _nodes[node].firstChild;
+    unsigned int d = 0;
+
+    if (firstChild != NO_CHILD)
+      for (unsigned int quadrant=0; quadrant<NB_SUBNODES; quadrant++)
+        d = std::max(d, _depth(firstChild + quadrant) + 1);
+
+    return d;
+  }
+
+  /**
+   * Recursive drawing subroutine
+   */
+  void _draw(sf::VertexArray* lines, sf::VertexArray* quads, const Bounds& b) const {
+    const Cell& cell = _nodes[b.index];
+
+    if (cell.firstChild == NO_CHILD) {
+      if (cell.count > 0)
+        Utils::rectangle(lines, quads, sf::FloatRect(b.x, b.y, b.width, b.height),
+                         sf::Color::Blue, sf::Color(0x00,0x33,0xCC,0x33));
+      return;
+    }
+
+    for (unsigned int quadrant=0; quadrant<NB_SUBNODES; quadrant++)
+      _draw(lines, quads, b.child(cell.firstChild, quadrant));
+  }
+};
+
+#endif
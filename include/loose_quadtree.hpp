@@ -0,0 +1,505 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+
+#ifndef LOOSE_QUADTREE_HPP
+#define LOOSE_QUADTREE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "quadtree.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Default ratio between the loose and the tight side of a node
+#define LOOSENESS 2.0f
+
+// Deepest level, so that cell coordinates fit in the keys
+#define LOOSE_MAX_DEPTH 16
+
+// Index of no cell
+#define NO_CELL 0xFFFFFFFFu
+
+/**
+ * Loose quadtree: the bounds of each node are enlarged by a looseness
+ * factor k around its tight square, so that every element lives in exactly
+ * one node, whatever its size. The level of an element is computed from its
+ * radius, the deepest whose margin (k-1)/2 of the node side still holds it,
+ * and its node from its center: nodes are cells of an implicit grid per
+ * level, and only non-empty ones are stored, in a hash table.
+ * Same interface as the quadtrees (see spatial_index.hpp) with
+ * Insertion::Loose: non-empty nodes play the role of leaves, and pairs
+ * between nodes come from getNeighbors(), which walks the neighbors at the
+ * same level and the overlapping nodes at the levels above.
+ */
+class LooseQuadtree {
+  using Position = sf::Vector2f;
+  using Rectangle = sf::Rect<int>;
+  using EntityId = unsigned int;
+
+public:
+  using Leaf = std::uint32_t;
+
+  /**
+   * Constructor
+   * @param area covered by the root node
+   */
+  LooseQuadtree(const Rectangle& r):
+    _area(r), _cells(), _used(0), _table(), _mask(0), _levels(0), _capacity(MAX_ELEMENTS),
+    _maxDepth(MAX_DEPTH), _depth(0), _side(std::max(r.width, r.height)), _margin(0), _reach(0) {
+    setLooseness(LOOSENESS);
+    _table.assign(64, NO_CELL);
+    _mask = _table.size() - 1;
+  }
+
+  /**
+   * Add an element in the node matching its size
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param index of object to add in tree
+   */
+  template<typename T>
+  void add(const T& entities, EntityId id) {
+    const Position p = entities[id].getPosition();
+    const unsigned int level = _level(entities[id].getRadius());
+
+    _cells[_acquire(level, _cell(level, p.x - _area.left), _cell(level, p.y - _area.top))].elements.push_back(id);
+  }
+
+  /**
+   * Rebuild the tree, its depth fit to the number of elements
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param number of elements, indexed from 0
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count) {
+    clear();
+
+    // Deepest nodes hold about capacity elements when they are uniform
+    const double cells = double(count) / _capacity;
+    _depth = cells > 1 ? std::min<unsigned int>(std::floor(std::log2(cells) / 2 + 0.5), _maxDepth) : 0;
+
+    for (EntityId id=0; id<count; id++)
+      add(entities, id);
+  }
+
+  /**
+   * Rebuild the whole tree: the build is serial
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count, Workers&) {
+    build(entities, count);
+  }
+
+  /**
+   * Update the tree after elements moved: a rebuild, as placing an element
+   * costs the same as finding it
+   * @return number of elements inserted
+   */
+  template<typename T>
+  unsigned int update(const T& entities, unsigned int count) {
+    build(entities, count);
+    return count;
+  }
+
+  /**
+   * Remove an element: nothing to do, as update() rebuilds the tree
+   */
+  void erase(EntityId, EntityId) {}
+
+  /**
+   * Find the deepest non-empty node containing a position in its tight
+   * bounds
+   * @param position, clamped to the root
+   * @return the node, NO_CELL if there is none
+   */
+  Leaf locate(const Position& p) const {
+    for (int level=_depth; level>=0; level--)
+      if (_levels >> level & 1) {
+        Leaf leaf = _find(level, _cell(level, p.x - _area.left), _cell(level, p.y - _area.top));
+        if (leaf != NO_CELL)
+          return leaf;
+      }
+
+    return NO_CELL;
+  }
+
+  /**
+   * Visit the non-empty nodes whose loose bounds overlap a rectangle,
+   * borders included
+   * @param rectangle
+   * @param function called with each node
+   */
+  template<typename F>
+  void forEachLeaf(const sf::FloatRect& r, const F& f) const {
+    const float left = r.left - _area.left;
+    const float top = r.top - _area.top;
+
+    for (unsigned int level=0; level<=_depth; level++)
+      if (_levels >> level & 1)
+        _forEachCell(level, left, top, left + r.width, top + r.height, f);
+  }
+
+  /**
+   * Append the elements of the other nodes whose pairs with the elements of
+   * a node are reported from it: the next neighbors at the same level, and
+   * the nodes above whose loose bounds overlap its own. Each pair of
+   * overlapping nodes is then walked once.
+   * @param node
+   * @param output array
+   * @return number of elements appended
+   */
+  unsigned int getNeighbors(Leaf leaf, std::vector<unsigned int>* out) const {
+    const Cell& cell = _cells[leaf];
+    const std::size_t before = out->size();
+
+    for (int dy=0; dy<=_reach; dy++)
+      for (int dx=-_reach; dx<=_reach; dx++)
+        if (dy > 0 || dx > 0)
+          _append(_find(cell.level, cell.x + dx, cell.y + dy), out);
+
+    const float size = _size(cell.level);
+    const float margin = _margin * size;
+    const float left = cell.x * size - margin;
+    const float top = cell.y * size - margin;
+    const float right = (cell.x + 1) * size + margin;
+    const float bottom = (cell.y + 1) * size + margin;
+
+    for (unsigned int level=0; level<cell.level; level++)
+      if (_levels >> level & 1)
+        _forEachCell(level, left, top, right, bottom, [&](Leaf above) {
+          _append(above, out);
+        });
+
+    return out->size() - before;
+  }
+
+  /**
+   * Insertion mode, which is always Insertion::Loose
+   */
+  void setInsertion(Insertion) {}
+
+  /**
+   * Getter for the insertion mode
+   */
+  inline Insertion getInsertion() const {
+    return Insertion::Loose;
+  }
+
+  /**
+   * Set the average number of elements of the deepest nodes, before building
+   * the tree
+   * @param capacity, at least 1
+   */
+  void setCapacity(unsigned int capacity) {
+    _capacity = std::max(1u, capacity);
+    clear();
+  }
+
+  /**
+   * Merge threshold, unused: the tree is rebuilt at each update
+   */
+  void setMergeThreshold(unsigned int) {}
+
+  /**
+   * Set the deepest level, before building the tree
+   * @param maximum depth, 0 for a single node
+   */
+  void setMaxDepth(unsigned int depth) {
+    _maxDepth = std::min(depth, unsigned(LOOSE_MAX_DEPTH));
+    clear();
+  }
+
+  /**
+   * Set the ratio between the loose and the tight side of the nodes, before
+   * building the tree
+   * @param looseness, above 1
+   */
+  void setLooseness(float looseness) {
+    looseness = std::max(looseness, 1.01f);
+    _margin = (looseness - 1) / 2;
+    _reach = std::max(1, int(std::ceil(looseness)) - 1);
+    clear();
+  }
+
+  /**
+   * Fill an array with the non-empty nodes
+   * @param output array
+   */
+  void getLeaves(std::vector<Leaf>* out) const {
+    for (Leaf leaf=0; leaf<_used; leaf++)
+      out->push_back(leaf);
+  }
+
+  /**
+   * Getter for node elements
+   * @param node index
+   * @param output array
+   * @return the output size
+   */
+  unsigned int getElements(Leaf leaf, unsigned int** data) {
+    *data = _cells[leaf].elements.data();
+    return _cells[leaf].elements.size();
+  }
+
+  /**
+   * Drawing function: append the tight bounds of non-empty nodes to batched
+   * vertex arrays
+   * @param line list receiving node outlines
+   * @param quad list receiving node fillings
+   */
+  void draw(sf::VertexArray* lines, sf::VertexArray* quads) const {
+    for (Leaf leaf=0; leaf<_used; leaf++) {
+      const Cell& cell = _cells[leaf];
+      const float size = _size(cell.level);
+
+      Utils::rectangle(lines, quads,
+                       sf::FloatRect(_area.left + cell.x * size, _area.top + cell.y * size, size, size),
+                       sf::Color::Blue, sf::Color(0x00,0x33,0xCC,0x33));
+    }
+  }
+
+  /**
+   * Empty all nodes, keeping their capacity
+   */
+  void clear() {
+    for (Leaf leaf=0; leaf<_used; leaf++)
+      _cells[leaf].elements.clear();
+    _used = 0;
+    _levels = 0;
+    std::fill(_table.begin(), _table.end(), NO_CELL);
+  }
+
+  /**
+   * Getter for the number of non-empty nodes
+   */
+  inline unsigned int size() const {
+    return _used;
+  }
+
+  /**
+   * Compute the depth of the tree
+   * @return deepest non-empty level
+   */
+  unsigned int depth() const {
+    unsigned int d = 0;
+    for (unsigned int level=0; level<=LOOSE_MAX_DEPTH; level++)
+      if (_levels >> level & 1)
+        d = level;
+    return d;
+  }
+
+private:
+  // Non-empty node, a cell of the grid of its level
+  struct Cell {
+    std::uint32_t level;
+    std::int32_t x;
+    std::int32_t y;
+    std::vector<EntityId> elements;
+  };
+
+  // Area of the tight root
+  Rectangle _area;
+
+  // Nodes, the first _used ones non-empty: the others keep their buffers
+  std::vector<Cell> _cells;
+  std::uint32_t _used;
+
+  // Open-addressing table from cell coordinates to nodes
+  std::vector<std::uint32_t> _table;
+  std::uint32_t _mask;
+
+  // One bit per non-empty level
+  std::uint32_t _levels;
+
+  // Average number of elements of the deepest nodes
+  unsigned int _capacity;
+
+  // Deepest level allowed, and deepest level of the current build
+  unsigned int _maxDepth;
+  unsigned int _depth;
+
+  // Side of the root node
+  float _side;
+
+  // Margin of the loose bounds around a node, relative to its side
+  float _margin;
+
+  // Distance in cells between nodes of a level whose loose bounds overlap
+  int _reach;
+
+  /**
+   * Side of the nodes of a level
+   */
+  inline float _size(unsigned int level) const {
+    return std::ldexp(_side, -int(level));
+  }
+
+  /**
+   * Deepest level whose margin holds an element, O(1)
+   * @param element radius
+   */
+  inline unsigned int _level(float radius) const {
+    if (radius <= 0)
+      return _depth;
+
+    // 2^level <= margin * side / radius
+    const float fit = _margin * _side / radius;
+    if (fit < 1)
+      return 0;
+
+    return std::min<unsigned int>(std::ilogb(fit), _depth);
+  }
+
+  /**
+   * Cell coordinate of a position coordinate, relative to the root
+   * @param level
+   * @param coordinate, clamped to the root
+   */
+  inline int _cell(unsigned int level, float v) const {
+    const int last = (1 << level) - 1;
+    return std::min(std::max(int(std::floor(std::ldexp(v / _side, level))), 0), last);
+  }
+
+  /**
+   * Slot of a cell in the hash table
+   */
+  inline std::uint32_t _home(unsigned int level, int x, int y) const {
+    const std::uint64_t key = std::uint64_t(level) << 48 | std::uint64_t(std::uint32_t(x)) << 24 | std::uint32_t(y);
+    return (key * 0x9E3779B97F4A7C15ull) >> 32 & _mask;
+  }
+
+  /**
+   * Find a non-empty node
+   * @return the node, NO_CELL if empty
+   */
+  Leaf _find(unsigned int level, int x, int y) const {
+    for (std::uint32_t slot=_home(level, x, y); ; slot=(slot + 1) & _mask) {
+      const Leaf leaf = _table[slot];
+
+      if (leaf == NO_CELL)
+        return NO_CELL;
+
+      const Cell& cell = _cells[leaf];
+      if (cell.level == level && cell.x == x && cell.y == y)
+        return leaf;
+    }
+  }
+
+  /**
+   * Find a node, making it non-empty if needed
+   * @return the node
+   */
+  Leaf _acquire(unsigned int level, int x, int y) {
+    std::uint32_t slot = _home(level, x, y);
+
+    for (; _table[slot] != NO_CELL; slot=(slot + 1) & _mask) {
+      const Cell& cell = _cells[_table[slot]];
+      if (cell.level == level && cell.x == x && cell.y == y)
+        return _table[slot];
+    }
+
+    if (_used == _cells.size())
+      _cells.emplace_back();
+
+    Cell& cell = _cells[_used];
+    cell.level = level;
+    cell.x = x;
+    cell.y = y;
+    _table[slot] = _used;
+    _levels |= 1u << level;
+
+    // At most half full, so that probes stay short
+    if (++_used * 2 > _table.size())
+      _grow();
+
+    return _used - 1;
+  }
+
+  /**
+   * Double the hash table
+   */
+  void _grow() {
+    _table.assign(2 * _table.size(), NO_CELL);
+    _mask = _table.size() - 1;
+
+    for (Leaf leaf=0; leaf<_used; leaf++) {
+      std::uint32_t slot = _home(_cells[leaf].level, _cells[leaf].x, _cells[leaf].y);
+      while (_table[slot] != NO_CELL)
+        slot = (slot + 1) & _mask;
+      _table[slot] = leaf;
+    }
+  }
+
+  /**
+   * Append the elements of a node
+   * @param node, ignored if NO_CELL
+   * @param output array
+   */
+  inline void _append(Leaf leaf, std::vector<unsigned int>* out) const {
+    if (leaf != NO_CELL)
+      out->insert(out->end(), _cells[leaf].elements.begin(), _cells[leaf].elements.end());
+  }
+
+  /**
+   * Visit the non-empty nodes of a level whose loose bounds overlap a
+   * rectangle relative to the root, borders included
+   * @param level
+   * @param rectangle left
+   * @param rectangle top
+   * @param rectangle right
+   * @param rectangle bottom
+   * @param function called with each node
+   */
+  template<typename F>
+  void _forEachCell(unsigned int level, float left, float top, float right, float bottom, const F& f) const {
+    const float margin = _margin * _size(level);
+    const int x0 = _cell(level, left - margin);
+    const int y0 = _cell(level, top - margin);
+    const int x1 = _cell(level, right + margin);
+    const int y1 = _cell(level, bottom + margin);
+
+    // Large rectangles: scanning the non-empty nodes is cheaper
+    if (std::uint64_t(x1 - x0 + 1) * (y1 - y0 + 1) > _used) {
+      for (Leaf leaf=0; leaf<_used; leaf++) {
+        const Cell& cell = _cells[leaf];
+        if (cell.level == level && cell.x >= x0 && cell.x <= x1 && cell.y >= y0 && cell.y <= y1)
+          f(leaf);
+      }
+      return;
+    }
+
+    for (int y=y0; y<=y1; y++)
+      for (int x=x0; x<=x1; x++) {
+        const Leaf leaf = _find(level, x, y);
+        if (leaf != NO_CELL)
+          f(leaf);
+      }
+  }
+};
+
+#endif
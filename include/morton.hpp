@@ -0,0 +1,90 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+#include <cstdint>
+#include <vector>
+
+struct Morton {
+  /**
+   * Spread the 16 bits of a value over the even bits of a 32-bit word
+   */
+  static inline std::uint32_t spread(std::uint32_t v) {
+    v &= 0x0000FFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  }
+
+  /**
+   * Compute the Z-order code of a cell.
+   * Each pair of bits, from the most significant one, is the quadrant at the
+   * corresponding depth: bit 0 for east, bit 1 for south.
+   * @param column in [0, 65535]
+   * @param row in [0, 65535]
+   */
+  static inline std::uint32_t encode(std::uint32_t x, std::uint32_t y) {
+    return spread(x) | (spread(y) << 1);
+  }
+
+  /**
+   * Quadrant of a code at a given depth (0 for the root children)
+   */
+  static inline unsigned int quadrant(std::uint32_t code, unsigned int depth) {
+    return (code >> (30 - 2*depth)) & 3;
+  }
+
+  /**
+   * Sort keys on their 32 most significant bits (LSD radix sort, stable)
+   * @param keys to sort, code in high bits and payload in low bits
+   * @param scratch buffer, resized if needed
+   */
+  static void sort(std::vector<std::uint64_t>& keys, std::vector<std::uint64_t>& scratch) {
+    scratch.resize(keys.size());
+
+    for (unsigned int shift=32; shift<64; shift+=8) {
+      std::uint32_t offsets[256] = {0};
+
+      for (auto key: keys)
+        offsets[(key >> shift) & 0xFF]++;
+
+      std::uint32_t total = 0;
+      for (auto& offset: offsets) {
+        std::uint32_t count = offset;
+        offset = total;
+        total += count;
+      }
+
+      for (auto key: keys)
+        scratch[offsets[(key >> shift) & 0xFF]++] = key;
+
+      keys.swap(scratch);
+    }
+  }
+};
+
+#endif
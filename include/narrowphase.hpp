@@ -0,0 +1,96 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef NARROWPHASE_HPP
+#define NARROWPHASE_HPP
+
+#include <vector>
+#include "particles.hpp"
+
+// Number of candidates tested at once
+#if defined(__AVX__)
+#define NARROWPHASE_LANES 8
+#elif defined(__SSE2__)
+#define NARROWPHASE_LANES 4
+#else
+#define NARROWPHASE_LANES 1
+#endif
+
+/**
+ * Circle-circle tests between the candidates of a leaf.
+ * Candidates are copied in contiguous, padded arrays so that one particle is
+ * tested against NARROWPHASE_LANES others per instruction (AVX, SSE, or
+ * scalar fallback depending on the target). Each worker needs its own
+ * instance.
+ */
+class NarrowPhase {
+  using EntityId = unsigned int;
+
+public:
+  /**
+   * Constructor
+   */
+  NarrowPhase():_x(), _y(), _r(), _out(), _count(0) {}
+
+  /**
+   * Copy the candidates of a leaf
+   * @param particles
+   * @param candidate indices
+   * @param number of candidates
+   * @param true to test the circles bounding the motion of the last update
+   */
+  void load(const Particles& particles, const EntityId* ids, unsigned int count, bool swept = false);
+
+  /**
+   * Find the candidates colliding with candidate i, among those after it
+   * @param candidate index, in [0, count)
+   * @param output array of candidate indices, valid until next call
+   * @return the output size
+   */
+  inline unsigned int collide(unsigned int i, const unsigned int** out) {
+    return collide(i, _count, out);
+  }
+
+  /**
+   * Find the candidates colliding with candidate i, among those after it
+   * and before a given one
+   * @param candidate index, in [0, count)
+   * @param end of the tested candidates, in (i, count]
+   * @param output array of candidate indices, valid until next call
+   * @return the output size
+   */
+  unsigned int collide(unsigned int i, unsigned int end, const unsigned int** out);
+
+private:
+  // Candidates attributes, padded with particles that collide with nothing
+  std::vector<float> _x;
+  std::vector<float> _y;
+  std::vector<float> _r;
+
+  // Result buffer
+  std::vector<unsigned int> _out;
+
+  unsigned int _count;
+};
+
+#endif
@@ -0,0 +1,149 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef PAIR_CACHE_HPP
+#define PAIR_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Colliding pairs of the last frames, to tell new contacts from persistent
+ * ones. Pairs are stored in an open-addressing hash table keyed by the
+ * ordered particle indices, with the frame they were last seen in: the
+ * table is only reallocated when it grows.
+ */
+class PairCache {
+  using EntityId = unsigned int;
+
+public:
+  // Change of a contact during a frame
+  enum class Phase {
+    Begin,
+    Stay,
+    End
+  };
+
+  struct Contact {
+    EntityId a;
+    EntityId b;
+    Phase phase;
+  };
+
+  /**
+   * Constructor
+   */
+  PairCache();
+
+  /**
+   * Start recording the pairs of a frame. Events of the last frame are
+   * dropped, not those of removals made since.
+   */
+  void beginFrame();
+
+  /**
+   * Record a colliding pair
+   * @param a particle
+   * @param another particle
+   * @return true for a new contact, false if the pair was already colliding
+   *         in the last frame
+   */
+  bool touch(EntityId a, EntityId b);
+
+  /**
+   * Stop recording: pairs which were not touched since beginFrame() end
+   */
+  void endFrame();
+
+  /**
+   * End the contacts of a removed particle, between two frames, so that a
+   * particle taking its place does not inherit them
+   * @param particle
+   */
+  void remove(EntityId a);
+
+  /**
+   * Getter for the contact events of the last frame, in the order they
+   * happened: ends of removed particles first, then begins and stays, then
+   * ends
+   */
+  inline const std::vector<Contact>& getEvents() const {
+    return _events;
+  }
+
+  /**
+   * Getter for the number of contacts
+   */
+  inline unsigned int size() const {
+    return _keys.size();
+  }
+
+private:
+  // Ordered pair, never 0 as a particle does not collide with itself
+  static constexpr std::uint64_t EMPTY = 0;
+
+  struct Slot {
+    std::uint64_t key;
+    std::uint32_t frame;
+  };
+
+  /**
+   * Ordered pair key
+   */
+  static inline std::uint64_t _key(EntityId a, EntityId b) {
+    return a < b ? std::uint64_t(a) << 32 | b : std::uint64_t(b) << 32 | a;
+  }
+
+  /**
+   * Home slot of a key
+   */
+  inline std::uint32_t _home(std::uint64_t key) const {
+    return (key * 0x9E3779B97F4A7C15ull) >> 32 & _mask;
+  }
+
+  /**
+   * Remove a key, shifting back the following ones of its probe sequence
+   * @param slot of the key
+   */
+  void _erase(std::uint32_t slot);
+
+  /**
+   * Double the table size
+   */
+  void _grow();
+
+  // Hash table, a power of 2 in size
+  std::vector<Slot> _slots;
+  std::uint32_t _mask;
+
+  // Keys in the table, to find ended contacts without scanning it
+  std::vector<std::uint64_t> _keys;
+
+  std::vector<Contact> _events;
+  std::uint32_t _frame;
+
+  // Number of events recorded by the last frame, before removals
+  std::uint32_t _recorded;
+};
+
+#endif
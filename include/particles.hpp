@@ -0,0 +1,317 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef PARTICLES_HPP
+#define PARTICLES_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <SFML/System/Vector2.hpp>
+
+// Index of no particle
+#define NO_PARTICLE 0xFFFFFFFFu
+
+// Time of impact of particles which do not touch during an update
+#define NO_IMPACT 2.0f
+
+/**
+ * Simulation state of all particles, one contiguous array per attribute.
+ * Rendering data lives elsewhere: the physics loop only reads and writes
+ * these arrays.
+ * Arrays stay dense: removing a particle moves the last one in its place.
+ * Particles are then referred to across removals by handles, a slot which
+ * keeps the particle index and a generation telling whether the slot was
+ * reused since the handle was given.
+ */
+struct Particles {
+  using EntityId = unsigned int;
+
+  /**
+   * Stable reference to a particle
+   */
+  struct Handle {
+    std::uint32_t slot;
+    std::uint32_t generation;
+  };
+
+  /**
+   * Read-only view on one particle, as expected by the trees
+   */
+  struct Particle {
+    const Particles* particles;
+    EntityId id;
+
+    inline sf::Vector2f getPosition() const {
+      return sf::Vector2f(particles->x[id], particles->y[id]);
+    }
+
+    inline float getRadius() const {
+      return particles->radius[id];
+    }
+  };
+
+  /**
+   * Read-only view on the circle bounding the motion of one particle over
+   * the last update, as expected by the trees
+   */
+  struct Motion {
+    const Particles* particles;
+    EntityId id;
+
+    inline sf::Vector2f getPosition() const {
+      const Particles& p = *particles;
+      return sf::Vector2f((p.px[id] + p.x[id]) / 2, (p.py[id] + p.y[id]) / 2);
+    }
+
+    inline float getRadius() const {
+      return particles->getSweptRadius(id);
+    }
+  };
+
+  /**
+   * Motions of all particles, indexed like them
+   */
+  struct Motions {
+    const Particles* particles;
+
+    inline Motion operator[](EntityId id) const {
+      return Motion{particles, id};
+    }
+
+    inline unsigned int size() const {
+      return particles->size();
+    }
+  };
+
+  // Positions
+  std::vector<float> x;
+  std::vector<float> y;
+
+  // Positions before the last update, for render interpolation
+  std::vector<float> px;
+  std::vector<float> py;
+
+  // Velocities, in pixels per second
+  std::vector<float> vx;
+  std::vector<float> vy;
+
+  std::vector<float> radius;
+
+  // Non-zero once a particle has bounced
+  std::vector<std::uint8_t> hit;
+
+  // Slot of each particle
+  std::vector<std::uint32_t> slot;
+
+  /**
+   * Add a particle
+   * @param position
+   * @param velocity
+   * @param radius in pixel
+   * @return particle index
+   */
+  EntityId add(const sf::Vector2f& position, const sf::Vector2f& velocity, float r);
+
+  /**
+   * Add a particle, reusing a free slot if any
+   * @param position
+   * @param velocity
+   * @param radius in pixel
+   * @return handle on the particle
+   */
+  Handle spawn(const sf::Vector2f& position, const sf::Vector2f& velocity, float r);
+
+  /**
+   * Remove a particle: the last particle takes its index
+   * @param particle index
+   */
+  void remove(EntityId id);
+
+  /**
+   * Remove a particle if it still exists
+   * @param handle
+   * @return false if the handle was stale
+   */
+  bool despawn(Handle handle);
+
+  /**
+   * Find a particle from its handle
+   * @param handle
+   * @return particle index, NO_PARTICLE if the handle is stale
+   */
+  inline EntityId find(Handle handle) const {
+    if (handle.slot >= _slots.size() || _slots[handle.slot].generation != handle.generation)
+      return NO_PARTICLE;
+    return _slots[handle.slot].index;
+  }
+
+  /**
+   * Getter for the handle of a particle
+   * @param particle index
+   */
+  inline Handle getHandle(EntityId id) const {
+    return Handle{slot[id], _slots[slot[id]].generation};
+  }
+
+  /**
+   * Remove all particles. Slots are kept, so that older handles stay stale.
+   */
+  void clear();
+
+  /**
+   * Getter for the number of particles
+   */
+  inline unsigned int size() const {
+    return x.size();
+  }
+
+  /**
+   * Access a particle
+   * @param particle index
+   * @return view on the particle
+   */
+  inline Particle operator[](EntityId id) const {
+    return Particle{this, id};
+  }
+
+  /**
+   * Access the motions of the last update
+   */
+  inline Motions getMotions() const {
+    return Motions{this};
+  }
+
+  /**
+   * Radius of the circle bounding the motion of a particle over the last
+   * update, centered halfway
+   * @param particle index
+   */
+  inline float getSweptRadius(EntityId id) const {
+    const float dx = x[id] - px[id];
+    const float dy = y[id] - py[id];
+    return radius[id] + std::sqrt(dx*dx + dy*dy) / 2;
+  }
+
+  /**
+   * Move all particles and bounce them on the borders of the playable area
+   * @param time step in seconds
+   * @param area width
+   * @param area height
+   */
+  void update(double dt, float width, float height);
+
+  /**
+   * Collision detection
+   * @param a particle
+   * @param another particle
+   * @return true if they overlap
+   */
+  inline bool isColliding(EntityId i, EntityId j) const {
+    float dx = x[j] - x[i];
+    float dy = y[j] - y[i];
+    float r = radius[i] + radius[j];
+    return dx*dx + dy*dy < r*r;
+  }
+
+  /**
+   * Continuous collision detection: first time at which two particles
+   * touch during the last update, both moving in a straight line
+   * @param a particle
+   * @param another particle
+   * @return fraction of the update in [0, 1], 0 if they already overlapped
+   * and got closer, more than 1 if they do not touch
+   */
+  inline float timeOfImpact(EntityId i, EntityId j) const {
+    // Relative position at the start of the update, and relative motion
+    const float sx = px[j] - px[i];
+    const float sy = py[j] - py[i];
+    const float mx = (x[j] - px[j]) - (x[i] - px[i]);
+    const float my = (y[j] - py[j]) - (y[i] - py[i]);
+    const float r = radius[i] + radius[j];
+
+    // Moving apart, or together
+    const float b = sx*mx + sy*my;
+    if (b >= 0)
+      return NO_IMPACT;
+
+    const float c = sx*sx + sy*sy - r*r;
+    if (c < 0)
+      return 0;
+
+    // First root of |s + t*m| = r
+    const float a = mx*mx + my*my;
+    const float delta = b*b - a*c;
+    if (delta < 0)
+      return NO_IMPACT;
+
+    return (-b - std::sqrt(delta)) / a;
+  }
+
+  /**
+   * Make two colliding particles go away from each other
+   * @param a particle
+   * @param another particle
+   */
+  void bounce(EntityId i, EntityId j);
+
+  /**
+   * Resolve a contact found by timeOfImpact(): move both particles back to
+   * where they touched, respond to the contact, and move them with their
+   * new velocity for the rest of the update
+   * @template function called with both particles
+   * @param a particle
+   * @param another particle
+   * @param time of impact, fraction of the update
+   * @param duration of the update in seconds
+   * @param response, changing the velocities
+   */
+  template<typename F>
+  void impact(EntityId i, EntityId j, float t, double dt, const F& respond) {
+    const float rest = (1 - t) * dt;
+
+    for (EntityId k: {i, j}) {
+      x[k] = px[k] + t * (x[k] - px[k]);
+      y[k] = py[k] + t * (y[k] - py[k]);
+    }
+
+    respond(i, j);
+
+    for (EntityId k: {i, j}) {
+      x[k] += vx[k] * rest;
+      y[k] += vy[k] * rest;
+    }
+  }
+
+private:
+  // Particle index of a slot, NO_PARTICLE for a free slot
+  struct Slot {
+    std::uint32_t index;
+    std::uint32_t generation;
+  };
+
+  std::vector<Slot> _slots;
+  std::vector<std::uint32_t> _free;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <vector>
+
+/**
+ * Object pool with one-step reset.
+ * Objects are allocated once and recycled on each reset, so a structure
+ * rebuilt every frame only reaches the heap while it is still growing.
+ * @template type of pooled objects (must be default-constructible)
+ */
+template<typename T>
+class Pool {
+public:
+  /**
+   * Constructor
+   */
+  Pool():_objects(), _free(), _used(0), _allocations(0) {}
+
+  /**
+   * Destructor
+   */
+  ~Pool() {
+    for (auto object: _objects)
+      delete object;
+  }
+
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+
+  /**
+   * Get an object from the pool, creating one only if all are in use
+   * @return an object owned by the pool
+   */
+  T* acquire() {
+    // Objects given back one by one are reused first
+    if (not _free.empty()) {
+      T* object = _free.back();
+      _free.pop_back();
+      return object;
+    }
+
+    if (_used == _objects.size()) {
+      // The object list itself may have to grow
+      if (_objects.size() == _objects.capacity())
+        _allocations++;
+
+      _objects.push_back(new T());
+      _allocations++;
+    }
+
+    return _objects[_used++];
+  }
+
+  /**
+   * Give back one object
+   * @param object obtained from acquire()
+   */
+  void release(T* object) {
+    if (_free.size() == _free.capacity())
+      _allocations++;
+
+    _free.push_back(object);
+  }
+
+  /**
+   * Give back all objects at once
+   */
+  inline void reset() {
+    _used = 0;
+    _free.clear();
+  }
+
+  /**
+   * Record an allocation made by a pooled object
+   */
+  inline void countAllocation() {
+    _allocations++;
+  }
+
+  /**
+   * Getter for the number of objects in use
+   * @return objects acquired since last reset
+   */
+  inline unsigned int size() const {
+    return _used - _free.size();
+  }
+
+  /**
+   * Getter for the allocation counter
+   * @return number of heap allocations since pool creation
+   */
+  inline unsigned long allocations() const {
+    return _allocations;
+  }
+
+private:
+  // All objects ever created by the pool
+  std::vector<T*> _objects;
+
+  // Objects released since last reset
+  std::vector<T*> _free;
+
+  // Number of objects handed out since last reset
+  unsigned int _used;
+
+  // Heap allocations performed so far
+  unsigned long _allocations;
+};
+
+#endif
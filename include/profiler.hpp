@@ -0,0 +1,180 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Frame profiler: durations of named phases and counters, for the last
+ * frame, plus an optional Chrome trace (chrome://tracing, Perfetto) of all
+ * frames recorded between startTrace() and stopTrace().
+ * Only use it through the PROFILE_* macros, which compile to nothing
+ * unless ENABLE_PROFILER is defined. Phases and counters can be recorded
+ * from several threads, the trace keeps one track per thread.
+ */
+class Profiler {
+public:
+  struct Phase {
+    const char* name;
+    long long start;
+    long long duration;
+  };
+
+  struct Counter {
+    const char* name;
+    double value;
+  };
+
+  /**
+   * Getter for the profiler instance
+   */
+  static Profiler& get();
+
+  /**
+   * Start a new frame, forgetting the phases and counters of the last one
+   */
+  void beginFrame();
+
+  /**
+   * Record a phase of the current frame
+   * @param phase name, a string literal
+   * @param start time in microseconds, from now()
+   * @param duration in microseconds
+   */
+  void record(const char* name, long long start, long long duration);
+
+  /**
+   * Set a counter of the current frame
+   * @param counter name, a string literal
+   * @param value
+   */
+  void count(const char* name, double value);
+
+  /**
+   * Current time
+   * @return microseconds since the profiler creation
+   */
+  long long now() const;
+
+  /**
+   * Getter for the phases of the current frame
+   * @return a copy, as other threads may still record phases
+   */
+  std::vector<Phase> getPhases() const;
+
+  /**
+   * Getter for the counters of the current frame
+   * @return a copy, as other threads may still set counters
+   */
+  std::vector<Counter> getCounters() const;
+
+  /**
+   * Start recording a trace
+   */
+  void startTrace();
+
+  /**
+   * Stop recording and write the trace in Chrome JSON format
+   * @param output file name
+   * @return false if the file could not be written
+   */
+  bool stopTrace(const std::string& path);
+
+  /**
+   * Tell whether a trace is being recorded
+   */
+  inline bool isTracing() const {
+    return _tracing.load(std::memory_order_relaxed);
+  }
+
+private:
+  Profiler();
+
+  // Trace entry: a phase, or a counter if duration is negative
+  struct Event {
+    const char* name;
+    long long time;
+    long long duration;
+    double value;
+    unsigned int thread;
+  };
+
+  /**
+   * Getter for the trace track of the calling thread
+   */
+  static unsigned int _thread();
+
+  std::chrono::steady_clock::time_point _origin;
+  std::vector<Phase> _phases;
+  std::vector<Counter> _counters;
+  std::vector<Event> _trace;
+  long long _frameStart;
+  std::atomic<bool> _tracing;
+
+  // Guards phases, counters and the trace
+  mutable std::mutex _mutex;
+};
+
+/**
+ * Record the duration of the enclosing scope as a phase
+ */
+class ScopedTimer {
+public:
+  /**
+   * Constructor
+   * @param phase name, a string literal
+   */
+  ScopedTimer(const char* name):_name(name), _start(Profiler::get().now()) {}
+
+  /**
+   * Destructor
+   */
+  ~ScopedTimer() {
+    Profiler& profiler = Profiler::get();
+    profiler.record(_name, _start, profiler.now() - _start);
+  }
+
+private:
+  const char* _name;
+  long long _start;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_JOIN(A, B) A##B
+#define PROFILE_NAME(A, B) PROFILE_JOIN(A, B)
+#define PROFILE_SCOPE(NAME) ScopedTimer PROFILE_NAME(_profileScope, __LINE__)(NAME)
+#define PROFILE_COUNT(NAME, VALUE) Profiler::get().count(NAME, VALUE)
+#define PROFILE_FRAME() Profiler::get().beginFrame()
+#else
+#define PROFILE_SCOPE(NAME)
+#define PROFILE_COUNT(NAME, VALUE)
+#define PROFILE_FRAME()
+#endif
+
+#endif
@@ -23,70 +23,440 @@ SOFTWARE. */
 #ifndef QUADTREE_HPP
 #define QUADTREE_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <vector>
 #include <SFML/Graphics.hpp>
+#include "coordinate.hpp"
+#include "pool.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
 
-// A node in the quadtree.
+// A node in the quadtree. Children are indexed by quadrant: bit 0 set in
+// the east, bit 1 set in the south
 #define NB_SUBNODES 4
 #define NORTH_WEST 0
 #define NORTH_EAST 1
-#define SOUTH_EAST 2
-#define SOUTH_WEST 3
+#define SOUTH_WEST 2
+#define SOUTH_EAST 3
 
 #define MAX_ELEMENTS 10
 
-class Node {
+// Depth at which leaves stop splitting and grow instead
+#define MAX_DEPTH 16
+
+
+// Nodes smaller than this are not split when elements have a size
+#define MIN_NODE_SIZE 2
+
+// Levels split ahead by the parallel build, at most
+#define MAX_PARALLEL_DEPTH 4
+
+// Result of a nearest neighbor query
+struct Neighbor {
+  unsigned int id;
+
+  // Distance between the query position and the element center
+  float distance;
+};
+
+// How elements are dispatched in a tree
+enum class Insertion {
+  // In the leaf containing their center
+  Point,
+
+  // In every leaf overlapped by their bounding box
+  Bounds,
+
+  // In the one node matching their size, whose bounds are enlarged to hold
+  // them (LooseQuadtree)
+  Loose
+};
+
+/**
+ * Pointer-based quadtree, templated on the type of its node bounds: float,
+ * or Fixed for a precision independent of the distance to the origin.
+ * Children bounds are derived from their parent by halving, so siblings
+ * share their borders exactly and the whole root extent stays covered at
+ * any depth. Positions are converted once per insertion, not per level.
+ */
+template<typename Coordinate>
+class BasicNode {
   using Position = sf::Vector2f;
-  using Rectangle = sf::Rect<int>;
   using EntityId = unsigned int;
 
+  // Node bounds, right and bottom borders excluded
+  struct Area {
+    Coordinate left, top, right, bottom;
+  };
+
+  // Position converted to the coordinate type
+  struct Point {
+    Coordinate x, y;
+  };
+
 public:
+  using Leaf = BasicNode*;
+
   /**
-   * Constructor
-   * @param screen area associated to the node
+   * Constructor for pooled nodes
    */
-  Node(const Rectangle& r):_area(r), _elements(), _isLeaf(true) {
+  BasicNode():_area(), _center(), _elements(), _isLeaf(true), _tree(nullptr), _pool(nullptr), _parent(nullptr), _level(0),
+    _isRoot(false) {
     for (auto& node: _nodes)
       node = nullptr;
   }
 
+  /**
+   * Constructor for the root node, which owns the state shared by the tree
+   * @param screen area associated to the node
+   */
+  BasicNode(const sf::Rect<int>& r):BasicNode() {
+    _tree = new Tree();
+    _tree->insertion = Insertion::Point;
+    _tree->capacity = MAX_ELEMENTS;
+    _tree->merge = 0;
+    _tree->maxDepth = MAX_DEPTH;
+    _isRoot = true;
+    _pool = &_tree->pool;
+    _area = Area{Coordinate(float(r.left)), Coordinate(float(r.top)),
+                 Coordinate(float(r.left + r.width)), Coordinate(float(r.top + r.height))};
+  }
+
+  /**
+   * Destructor
+   */
+  ~BasicNode() {
+    // Children are owned by the pool, not by their parent
+    if (_isRoot)
+      delete _tree;
+  }
+
+  BasicNode(const BasicNode&) = delete;
+  BasicNode& operator=(const BasicNode&) = delete;
+
   /**
    * Add an element in the tree
    * @template type of elements referenced in the tree
-   * @entities the external array storing all objects
+   * @entities the external container storing all objects
    * @param index of object to add in tree
    */
   template<typename T>
-  void add(const T* entities, EntityId id) {
+  void add(const T& entities, EntityId id) {
+    _add(entities, id, _point(entities[id].getPosition()), _radius(entities, id));
+  }
 
-    // If this is not a leaf, object should be inserted in the correct child
-    if (not _isLeaf)
-      insertInSubnodes<T>(entities, id);
+  /**
+   * Rebuild the whole tree from scratch
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param number of objects
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count) {
+    clear();
+    _tree->leafOf.resize(count, nullptr);
 
-    // And if this node is a leaf, object is inserted
-    else {
-      _elements.push_back(id);
+    for (EntityId id=0; id<count; id++)
+      add(entities, id);
+  }
 
-      // If there is too much objects in the same node...
-      if (_elements.size() >= MAX_ELEMENTS) {
+  /**
+   * Rebuild the whole tree from scratch on several threads, into the same
+   * tree as build(). The top levels are split ahead, elements are dispatched
+   * to the subtrees below in a parallel pass, then each subtree is built by
+   * one task with its own node pool. Top nodes left with less than capacity
+   * elements are finally merged back. Must be called on the root.
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param number of objects
+   * @param threads
+   */
+  template<typename T>
+  void build(const T& entities, unsigned int count, Workers& workers) {
+    Tree& tree = *_tree;
 
-        // ...the node is split in 4...
-        _split();
+    // Enough subtrees for the workers to balance uneven ones
+    unsigned int levels = 1;
+    while ((1u << 2*levels) < 4*workers.size() && levels < MAX_PARALLEL_DEPTH)
+      levels++;
 
-        // ...and its elements are re-dispatched in its children
-        for (auto id: _elements)
-          insertInSubnodes<T>(entities, id);
+    // A root with less than capacity elements is a leaf, keeping elements
+    // out of the area
+    if (workers.size() < 2 || count < tree.capacity) {
+      build(entities, count);
+      return;
+    }
 
-        _elements.clear();
+    clear();
+    tree.leafOf.resize(count, nullptr);
+
+    // Subtrees must all be at the same depth, so that they can be numbered
+    tree.subtrees.clear();
+    if (not _splitAhead(levels)) {
+      build(entities, count);
+      return;
+    }
+
+    const unsigned int nbSubtrees = tree.subtrees.size();
+    const unsigned int nbChunks = 4*workers.size();
+
+    while (tree.pools.size() < nbSubtrees)
+      tree.pools.emplace_back();
+    for (unsigned int s=0; s<nbSubtrees; s++)
+      tree.subtrees[s]->_pool = &tree.pools[s];
+
+    // Each chunk of elements is dispatched into its own buckets...
+    tree.buckets.resize(nbChunks * nbSubtrees);
+    workers.run(nbChunks, [&](unsigned int, unsigned int chunk) {
+      std::vector<EntityId>* buckets = &tree.buckets[chunk * nbSubtrees];
+      const EntityId first = (unsigned long) count * chunk / nbChunks;
+      const EntityId last = (unsigned long) count * (chunk + 1) / nbChunks;
+
+      for (unsigned int s=0; s<nbSubtrees; s++)
+        buckets[s].clear();
+
+      for (EntityId id=first; id<last; id++)
+        _dispatch(id, _point(entities[id].getPosition()), _radius(entities, id), levels, 0, buckets);
+    });
+
+    // ...and read back in chunk order, so that subtrees get their elements
+    // in the same order as with a serial build
+    workers.run(nbSubtrees, [&](unsigned int, unsigned int s) {
+      BasicNode* subtree = tree.subtrees[s];
+
+      for (unsigned int chunk=0; chunk<nbChunks; chunk++)
+        for (auto id: tree.buckets[chunk * nbSubtrees + s])
+          subtree->add(entities, id);
+    });
+
+    _mergeAhead(levels);
+  }
+
+  /**
+   * Update the tree after elements have moved.
+   * Only elements which left their leaf are removed and re-inserted, from
+   * the closest ancestor containing them. Like insertions, leaves extend
+   * past the root borders, so elements out of the tree stay in the border
+   * leaf they were parked in. Siblings left underfull are then
+   * merged back into their parent. Elements added at the end of the
+   * container since the last call are inserted from the root. Falls back to
+   * build() on the first call, when elements were removed without erase(),
+   * or with Insertion::Bounds.
+   * Must be called on the root.
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param number of objects
+   * @return number of re-inserted objects
+   */
+  template<typename T>
+  unsigned int update(const T& entities, unsigned int count) {
+    std::vector<BasicNode*>& leafOf = _tree->leafOf;
+
+    if (_tree->insertion == Insertion::Bounds || leafOf.empty() || leafOf.size() > count) {
+      build(entities, count);
+      return count;
+    }
+
+    // New elements are out of the tree until inserted below
+    leafOf.resize(count, nullptr);
+
+    std::vector<BasicNode*>& shrunk = _tree->shrunk;
+    unsigned int moved = 0;
+
+    for (EntityId id=0; id<count; id++) {
+      BasicNode* leaf = leafOf[id];
+      const Point p = _point(entities[id].getPosition());
+
+      // Most elements stay in their leaf
+      if (leaf != nullptr && leaf->holds(p, _area))
+        continue;
+
+      // Elements out of the tree (null leaf) are retried from the root
+      BasicNode* node = this;
+
+      if (leaf != nullptr) {
+        leaf->_remove(id);
+        if (leaf->_parent != nullptr)
+          shrunk.push_back(leaf->_parent);
+
+        // Climb to the first ancestor containing the new position
+        node = leaf;
+        while (node->_parent != nullptr && not node->holds(p, _area))
+          node = node->_parent;
       }
+
+      leafOf[id] = nullptr;
+      node->_add(entities, id, p, Coordinate());
+      moved++;
     }
+
+    // Lazy merge, bottom-up from the parents of leaves which lost elements
+    for (auto node: shrunk)
+      while (node != nullptr && node->_merge())
+        node = node->_parent;
+    shrunk.clear();
+
+    return moved;
+  }
+
+  /**
+   * Remove an element, following a swap-and-pop of the external container:
+   * the last element takes the index of the removed one. Leaves left
+   * underfull are merged by the next update(). Must be called on the root.
+   * @param removed element index
+   * @param index of the last element before the removal
+   */
+  void erase(EntityId id, EntityId last) {
+    std::vector<BasicNode*>& leafOf = _tree->leafOf;
+
+    // With Insertion::Bounds, the next update() rebuilds the tree anyway
+    if (_tree->insertion == Insertion::Bounds)
+      return;
+
+    // The tree is not in sync with the container: let update() rebuild it
+    if (last + 1 != leafOf.size()) {
+      leafOf.clear();
+      return;
+    }
+
+    BasicNode* leaf = leafOf[id];
+    if (leaf != nullptr) {
+      leaf->_remove(id);
+      if (leaf->_parent != nullptr)
+        _tree->shrunk.push_back(leaf->_parent);
+    }
+
+    if (last != id) {
+      BasicNode* moved = leafOf[last];
+      if (moved != nullptr)
+        moved->_rename(last, id);
+      leafOf[id] = moved;
+    }
+
+    leafOf.pop_back();
+  }
+
+  /**
+   * Find the leaf containing a position
+   * @param position, moved to the tree border if it is out of the tree
+   * @return the leaf
+   */
+  Leaf locate(const Position& position) {
+    // Quadrants extend past the tree borders, which clamps the position
+    const Point p = _point(position);
+    BasicNode* node = this;
+
+    while (not node->_isLeaf)
+      node = node->_nodes[node->_quadrant(p)];
+
+    return node;
+  }
+
+  /**
+   * Choose how elements are dispatched, before building the tree.
+   * With Insertion::Bounds, elements must provide getRadius().
+   * @param insertion mode
+   */
+  void setInsertion(Insertion insertion) {
+    _tree->insertion = insertion;
+  }
+
+  /**
+   * Getter for the insertion mode
+   */
+  inline Insertion getInsertion() const {
+    return _tree->insertion;
+  }
+
+  /**
+   * Set the number of elements splitting a leaf, before building the tree
+   * @param leaf capacity, at least 1
+   */
+  void setCapacity(unsigned int capacity) {
+    _tree->capacity = std::max(1u, capacity);
+    clear();
+  }
+
+  /**
+   * Set the number of elements under which 4 sibling leaves are merged back
+   * by update()
+   * @param merge threshold, 0 for half the capacity
+   */
+  void setMergeThreshold(unsigned int merge) {
+    _tree->merge = merge;
+  }
+
+  /**
+   * Set the depth at which leaves stop splitting, before building the tree
+   * @param maximum depth, 0 for a single leaf
+   */
+  void setMaxDepth(unsigned int depth) {
+    _tree->maxDepth = depth;
+    clear();
+  }
+
+  /**
+   * Looseness, unused: nodes have tight bounds
+   */
+  void setLooseness(float) {}
+
+  /**
+   * Elements of other leaves to test against the elements of a leaf: none,
+   * as pairs never span leaves
+   * @return 0
+   */
+  unsigned int getNeighbors(Leaf, std::vector<unsigned int>*) const {
+    return 0;
+  }
+
+  /**
+   * Visit the leaves overlapping a rectangle, borders included
+   * @param rectangle
+   * @param function called with each leaf
+   */
+  template<typename F>
+  void forEachLeaf(const sf::FloatRect& r, const F& f) {
+    _forEachLeaf(Area{Coordinate(r.left), Coordinate(r.top), Coordinate(r.left + r.width),
+                      Coordinate(r.top + r.height)}, f);
+  }
+
+  /**
+   * Find the k elements closest to a position, by their center.
+   * Subtrees farther than the k-th closest element found so far are skipped,
+   * and the output buffer holds the candidates as a bounded max-heap, so
+   * nothing is allocated. Elements with a center out of the tree may be
+   * missed.
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param position
+   * @param number of neighbors wanted
+   * @param output buffer of k neighbors, sorted by increasing distance
+   * @return number of neighbors found, less than k if the tree is smaller
+   */
+  template<typename T>
+  unsigned int nearest(const T& entities, const Position& p, unsigned int k, Neighbor* out) {
+    unsigned int count = 0;
+
+    if (k == 0)
+      return 0;
+
+    // Squared distances while searching
+    _nearest(entities, p, k, out, &count);
+    std::sort_heap(out, out + count, _farther);
+
+    for (unsigned int i=0; i<count; i++)
+      out[i].distance = std::sqrt(out[i].distance);
+
+    return count;
   }
 
   /**
    * Fill an array with all the tree leaves
    * @param output array
    */
-  void getLeaves(std::vector<Node*>* out) {
+  void getLeaves(std::vector<BasicNode*>* out) {
     // If this node is a leaf, add it to the result...
     if (_isLeaf)
       out->push_back(this);
@@ -108,52 +478,128 @@ public:
   }
 
   /**
-   * Drawing function
+   * Getter for leaf elements, common to all tree implementations
+   * @param leaf returned by getLeaves()
+   * @param output array
+   * @return the output size
    */
-  void draw(sf::RenderWindow* w) {
-    sf::RectangleShape rect;
-    rect.setPosition(sf::Vector2f(_area.left, _area.top));
-    rect.setSize(sf::Vector2f(_area.width, _area.height));
-    rect.setOutlineColor(sf::Color::Blue);
-    rect.setOutlineThickness(1.0);
+  unsigned int getElements(Leaf leaf, unsigned int** data) {
+    return leaf->getElements(data);
+  }
 
-    if (_elements.size() > 0) {
-      rect.setFillColor(sf::Color(0x00,0x33,0xCC,0x33));
-      w->draw(rect);
-    }
-    else
-      rect.setFillColor(sf::Color::Transparent);
+  /**
+   * Drawing function: append non-empty leaves to batched vertex arrays
+   * @param line list receiving leaf outlines
+   * @param quad list receiving leaf fillings
+   */
+  void draw(sf::VertexArray* lines, sf::VertexArray* quads) const {
+    if (_elements.size() > 0)
+      Utils::rectangle(lines, quads, sf::FloatRect(float(_area.left), float(_area.top),
+                                                   float(_area.right - _area.left), float(_area.bottom - _area.top)),
+                       sf::Color::Blue, sf::Color(0x00,0x33,0xCC,0x33));
 
     for (auto node: _nodes)
       if (node != nullptr)
-        node->draw(w);
+        node->draw(lines, quads);
   }
 
 
   /**
-   * Clear the tree
+   * Clear the tree.
+   * Must be called on the root: all nodes go back to the pool at once.
    */
   void clear() {
-    for (auto& node: _nodes)
-      // Depth-first search for non-null nodes
-      if (node != nullptr) {
-        node->clear();
-        delete node;
-      }
+    _tree->pool.reset();
+    for (auto& pool: _tree->pools)
+      pool.reset();
+    _tree->leafOf.clear();
+    _tree->shrunk.clear();
 
     // As this node does not have children anymore, it becomes a leaf
-    _isLeaf = true;
+    _reset(_area, _tree, nullptr);
+  }
+
+  /**
+   * Getter for the number of nodes in the tree
+   * @return nodes, including the root
+   */
+  unsigned int size() const {
+    unsigned int nodes = _tree->pool.size() + 1;
+    for (auto& pool: _tree->pools)
+      nodes += pool.size();
+
+    return nodes;
+  }
+
+  /**
+   * Compute the depth of the subtree
+   * @return 0 for a leaf
+   */
+  unsigned int depth() const {
+    unsigned int d = 0;
+
+    if (not _isLeaf)
+      for (auto node: _nodes)
+        d = std::max(d, node->depth() + 1);
+
+    return d;
+  }
+
+  /**
+   * Getter for the allocation counter of the tree
+   * @return number of heap allocations since the tree creation
+   */
+  unsigned long getAllocations() const {
+    unsigned long allocations = _tree->pool.allocations();
+    for (auto& pool: _tree->pools)
+      allocations += pool.allocations();
+
+    return allocations;
   }
 
 
 
 private:
 
+  // State shared by all the nodes of a tree
+  struct Tree {
+    // Storage for all nodes
+    Pool<BasicNode> pool;
+
+    // Storage for the nodes of each subtree of a parallel build
+    std::deque<Pool<BasicNode>> pools;
+
+    // Roots of the subtrees of a parallel build, and elements dispatched
+    // to each of them by each chunk
+    std::vector<BasicNode*> subtrees;
+    std::vector<std::vector<EntityId>> buckets;
+
+    Insertion insertion;
+
+    // Number of elements splitting a leaf
+    unsigned int capacity;
+
+    // Number of elements under which siblings are merged, 0 for capacity/2
+    unsigned int merge;
+
+    // Depth of the deepest leaves
+    unsigned int maxDepth;
+
+    // Leaf holding each element, for update()
+    std::vector<BasicNode*> leafOf;
+
+    // Nodes which may have to be merged, kept between updates
+    std::vector<BasicNode*> shrunk;
+  };
+
   // 4 Children
-  Node* _nodes[NB_SUBNODES];
+  BasicNode* _nodes[NB_SUBNODES];
 
-  // Screen are associated to this node
-  Rectangle _area;
+  // Bounds of this node
+  Area _area;
+
+  // Shared corner of the children, once split
+  Point _center;
 
   // Referenced objects
   std::vector<EntityId> _elements;
@@ -161,50 +607,486 @@ private:
   // True if node is a leaf
   bool _isLeaf;
 
+  // Tree this node belongs to
+  Tree* _tree;
+
+  // Pool of the children
+  Pool<BasicNode>* _pool;
+
+  // Parent node, null for the root
+  BasicNode* _parent;
+
+  // Depth of the node, 0 for the root
+  unsigned int _level;
+
+  // True for the root node, which owns the tree state
+  bool _isRoot;
+
+  /**
+   * Reinitialize a node taken from the pool
+   * @param bounds of the node
+   * @param tree of the node
+   * @param parent node
+   */
+  void _reset(const Area& r, Tree* tree, BasicNode* parent) {
+    _area = r;
+    _tree = tree;
+    _parent = parent;
+    _pool = parent != nullptr ? parent->_pool : tree != nullptr ? &tree->pool : nullptr;
+    _level = parent != nullptr ? parent->_level + 1 : 0;
+    _isLeaf = true;
+
+    // Capacity is kept for the next frames, so this only allocates while
+    // warming up
+    _elements.clear();
+    if (tree != nullptr && _elements.capacity() < tree->capacity) {
+      _pool->countAllocation();
+      _elements.reserve(tree->capacity);
+    }
+
+    for (auto& node: _nodes)
+      node = nullptr;
+  }
+
+  /**
+   * Get a child node from the pool
+   * @param bounds of the child
+   */
+  BasicNode* _child(const Area& r) {
+    BasicNode* node = _pool->acquire();
+    node->_reset(r, _tree, this);
+    return node;
+  }
+
   /**
    * Creates the 4 children of a node
    */
   void _split() {
-    // Get the area coordinates
-    int x = _area.left;
-    int y = _area.top;
-    int width = _area.width;
-    int height = _area.height;
+    const Area& a = _area;
+
+    // Both children of each axis share the same middle, so that no position
+    // falls between them
+    const Coordinate x = a.left + (a.right - a.left) / 2;
+    const Coordinate y = a.top + (a.bottom - a.top) / 2;
+    _center = Point{x, y};
 
     // Create children nodes
-    _nodes[NORTH_WEST] = new Node(Rectangle(x, y, width/2, height/2));
-    _nodes[NORTH_EAST] = new Node(Rectangle(x + width/2, y, width/2, height/2));
-    _nodes[SOUTH_WEST] = new Node(Rectangle(x, y + height/2, width/2, height/2));
-    _nodes[SOUTH_EAST] = new Node(Rectangle(x + width/2, y + height/2, width/2, height/2));
+    _nodes[NORTH_WEST] = _child(Area{a.left, a.top, x, y});
+    _nodes[NORTH_EAST] = _child(Area{x, a.top, a.right, y});
+    _nodes[SOUTH_WEST] = _child(Area{a.left, y, x, a.bottom});
+    _nodes[SOUTH_EAST] = _child(Area{x, y, a.right, a.bottom});
 
     // This node is no more a leaf
     _isLeaf = false;
   }
 
+  /**
+   * Add an element in the subtree, once converted
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param index of object to add in tree
+   * @param object position
+   * @param object radius, with Insertion::Bounds
+   */
+  template<typename T>
+  void _add(const T& entities, EntityId id, const Point& p, Coordinate radius) {
+
+    // If this is not a leaf, object should be inserted in the correct child
+    if (not _isLeaf)
+      insertInSubnodes(entities, id, p, radius);
+
+    // And if this node is a leaf, object is inserted
+    else {
+      // Pooled nodes keep their buffer, so this only happens while warming up
+      if (_elements.size() == _elements.capacity())
+        _pool->countAllocation();
+
+      _elements.push_back(id);
+      _track(id);
+
+      // If there is too much objects in the same node...
+      if (_elements.size() >= _tree->capacity && _canSplit()) {
+
+        // ...the node is split in 4...
+        _split();
+
+        // ...and its elements are re-dispatched in its children
+        for (auto id: _elements) {
+          if (_tree->insertion == Insertion::Point)
+            _tree->leafOf[id] = nullptr;
+          insertInSubnodes(entities, id, _point(entities[id].getPosition()), _radius(entities, id));
+        }
+
+        _elements.clear();
+      }
+    }
+  }
+
   /**
    * Add an element in correct children of a node.
    * This is a recursive subroutine of add().
    * @template type of elements referenced in the tree
-   * @entities the external array storing all objects
+   * @entities the external container storing all objects
    * @param index of object to add in tree
+   * @param object position
+   * @param object radius, with Insertion::Bounds
    */
   template<typename T>
-  void insertInSubnodes(const T* entities, EntityId id) {
-    // Get the object positions
-    const Position& position = entities[id].getPosition();
+  void insertInSubnodes(const T& entities, EntityId id, const Point& p, Coordinate radius) {
+    // Objects with a size go in every child they overlap
+    if (_tree->insertion == Insertion::Bounds) {
+      for (auto node: _nodes)
+        if (node->overlaps(p, radius))
+          node->_add(entities, id, p, radius);
+
+      return;
+    }
+
+    // Points descend to their leaf without recursion, with one comparison
+    // per axis and level
+    BasicNode* node = _nodes[_quadrant(p)];
+    while (not node->_isLeaf)
+      node = node->_nodes[node->_quadrant(p)];
 
-    // Search for the correct children for the node to be inserted
+    node->_add(entities, id, p, radius);
+  }
+
+  /**
+   * Split nodes down to a given depth, for the parallel build
+   * @param number of levels to split
+   * @return false if a node cannot be split
+   */
+  bool _splitAhead(unsigned int levels) {
+    if (levels == 0) {
+      _tree->subtrees.push_back(this);
+      return true;
+    }
+
+    if (not _canSplit())
+      return false;
+
+    _split();
     for (auto node: _nodes)
-      if (node->contains(position))
-        node->add(entities, id);
+      if (not node->_splitAhead(levels - 1))
+        return false;
+
+    return true;
+  }
+
+  /**
+   * Add an element to the buckets of the subtrees it belongs to, for the
+   * parallel build. Subtrees are numbered by their path from this node.
+   * @param index of object to dispatch
+   * @param object position
+   * @param object radius, with Insertion::Bounds
+   * @param number of levels above the subtrees
+   * @param path to this node
+   * @param buckets of the chunk
+   */
+  void _dispatch(EntityId id, const Point& p, Coordinate radius, unsigned int levels, unsigned int path,
+                 std::vector<EntityId>* buckets) const {
+    if (levels == 0) {
+      buckets[path].push_back(id);
+      return;
+    }
+
+    // Same rules as insertInSubnodes()
+    if (_tree->insertion == Insertion::Bounds) {
+      for (unsigned int k=0; k<NB_SUBNODES; k++)
+        if (_nodes[k]->overlaps(p, radius))
+          _nodes[k]->_dispatch(id, p, radius, levels - 1, path * NB_SUBNODES + k, buckets);
+
+      return;
+    }
+
+    const unsigned int k = _quadrant(p);
+    _nodes[k]->_dispatch(id, p, radius, levels - 1, path * NB_SUBNODES + k, buckets);
+  }
+
+  /**
+   * Merge back the nodes split ahead by the parallel build which a serial
+   * build would not have split: those with less than capacity elements
+   * @param number of levels split ahead
+   * @return true if the node is a leaf
+   */
+  bool _mergeAhead(unsigned int levels) {
+    if (levels == 0)
+      return _isLeaf;
+
+    bool leaves = true;
+    for (auto node: _nodes)
+      leaves = node->_mergeAhead(levels - 1) && leaves;
+
+    // The root had enough elements to split
+    if (not leaves || _parent == nullptr)
+      return false;
+
+    // Elements overlapping several children are counted once
+    for (auto node: _nodes)
+      _elements.insert(_elements.end(), node->_elements.begin(), node->_elements.end());
+    std::sort(_elements.begin(), _elements.end());
+    _elements.erase(std::unique(_elements.begin(), _elements.end()), _elements.end());
+
+    if (_elements.size() >= _tree->capacity) {
+      _elements.clear();
+      return false;
+    }
+
+    for (auto& node: _nodes) {
+      node->_reset(Area(), _tree, nullptr);
+      _pool->release(node);
+      node = nullptr;
+    }
+
+    _isLeaf = true;
+    for (auto id: _elements)
+      _track(id);
+
+    return true;
+  }
+
+  /**
+   * Record the leaf holding an element
+   * @param element index
+   */
+  inline void _track(EntityId id) {
+    // Only used by update(), which rebuilds the tree with Insertion::Bounds
+    if (_tree->insertion == Insertion::Bounds)
+      return;
+
+    std::vector<BasicNode*>& leafOf = _tree->leafOf;
+
+    if (id >= leafOf.size())
+      leafOf.resize(id + 1, nullptr);
+
+    leafOf[id] = this;
+  }
+
+  /**
+   * Remove an element from a leaf
+   * @param element index
+   */
+  void _remove(EntityId id) {
+    for (auto& element: _elements)
+      if (element == id) {
+        element = _elements.back();
+        _elements.pop_back();
+        return;
+      }
+  }
+
+  /**
+   * Change the index of an element of this leaf
+   * @param current element index
+   * @param new element index
+   */
+  void _rename(EntityId from, EntityId to) {
+    for (auto& element: _elements)
+      if (element == from) {
+        element = to;
+        return;
+      }
+  }
+
+  /**
+   * Turn a node back into a leaf if its children are underfull leaves
+   * @return true if the node was merged
+   */
+  bool _merge() {
+    if (_isLeaf)
+      return false;
+
+    unsigned int total = 0;
+    for (auto node: _nodes) {
+      if (not node->_isLeaf)
+        return false;
+      total += node->_elements.size();
+    }
+
+    // Half the capacity by default, so that a merged leaf does not split
+    // right away
+    if (total >= (_tree->merge > 0 ? _tree->merge : _tree->capacity/2))
+      return false;
+
+    // Elements move up, and children go back to the pool
+    for (auto& node: _nodes) {
+      for (auto id: node->_elements) {
+        _elements.push_back(id);
+        _tree->leafOf[id] = this;
+      }
+
+      node->_reset(Area(), _tree, nullptr);
+      _pool->release(node);
+      node = nullptr;
+    }
+
+    _isLeaf = true;
+    return true;
+  }
+
+  /**
+   * Return true if the node can be split
+   */
+  inline bool _canSplit() const {
+    if (_level >= _tree->maxDepth)
+      return false;
+
+    // Duplicated elements would not get any sparser in smaller nodes
+    if (_tree->insertion == Insertion::Bounds) {
+      const Coordinate size(float(2*MIN_NODE_SIZE));
+      return _area.right - _area.left >= size && _area.bottom - _area.top >= size;
+    }
+
+    // Past the coordinate precision, a child would be as large as its parent
+    return _area.left + (_area.right - _area.left) / 2 > _area.left
+        && _area.top + (_area.bottom - _area.top) / 2 > _area.top;
+  }
+
+  /**
+   * Heap order of nearest(): the farthest candidate on top
+   */
+  static inline bool _farther(const Neighbor& a, const Neighbor& b) {
+    return a.distance < b.distance;
+  }
+
+  /**
+   * Squared distance between a position and the node area
+   */
+  inline float _distance(const Position& p) const {
+    const float dx = std::max({float(_area.left) - p.x, 0.0f, p.x - float(_area.right)});
+    const float dy = std::max({float(_area.top) - p.y, 0.0f, p.y - float(_area.bottom)});
+    return dx*dx + dy*dy;
+  }
+
+  /**
+   * Recursive subroutine of nearest()
+   * @param candidates found so far, as a max-heap of squared distances
+   * @param number of candidates
+   */
+  template<typename T>
+  void _nearest(const T& entities, const Position& p, unsigned int k, Neighbor* heap, unsigned int* count) {
+    if (_isLeaf) {
+      for (auto id: _elements) {
+        const Position d = entities[id].getPosition() - p;
+        const float distance = d.x*d.x + d.y*d.y;
+
+        if (*count == k && distance >= heap[0].distance)
+          continue;
+
+        // Elements with a size can be met again in other leaves
+        if (_tree->insertion == Insertion::Bounds
+            && std::any_of(heap, heap + *count, [id](const Neighbor& n) { return n.id == id; }))
+          continue;
+
+        if (*count == k)
+          std::pop_heap(heap, heap + (*count)--, _farther);
+
+        heap[(*count)++] = Neighbor{id, distance};
+        std::push_heap(heap, heap + *count, _farther);
+      }
+      return;
+    }
+
+    // Closest children first, so that the heap fills with good candidates
+    BasicNode* children[NB_SUBNODES];
+    float distances[NB_SUBNODES];
+
+    for (int i=0; i<NB_SUBNODES; i++) {
+      int j = i;
+      const float distance = _nodes[i]->_distance(p);
+
+      for (; j > 0 && distances[j-1] > distance; j--) {
+        children[j] = children[j-1];
+        distances[j] = distances[j-1];
+      }
+
+      children[j] = _nodes[i];
+      distances[j] = distance;
+    }
+
+    for (int i=0; i<NB_SUBNODES; i++)
+      if (*count < k || distances[i] < heap[0].distance)
+        children[i]->_nearest(entities, p, k, heap, count);
+  }
+
+  /**
+   * Recursive subroutine of forEachLeaf()
+   * @param rectangle, converted
+   * @param function called with each leaf
+   */
+  template<typename F>
+  void _forEachLeaf(const Area& r, const F& f) {
+    // Same convention as overlaps()
+    if (r.left >= _area.right || r.right < _area.left || r.top >= _area.bottom || r.bottom < _area.top)
+      return;
+
+    if (_isLeaf)
+      f(this);
+    else for (auto node: _nodes)
+      node->_forEachLeaf(r, f);
+  }
+
+  /**
+   * Convert a position to the coordinate type
+   */
+  static inline Point _point(const Position& p) {
+    return Point{Coordinate(p.x), Coordinate(p.y)};
+  }
+
+  /**
+   * Radius of an element, converted, if the insertion mode needs it
+   * @template type of elements referenced in the tree
+   * @entities the external container storing all objects
+   * @param element index
+   */
+  template<typename T>
+  inline Coordinate _radius(const T& entities, EntityId id) const {
+    return _tree->insertion == Insertion::Bounds ? Coordinate(entities[id].getRadius()) : Coordinate();
+  }
+
+  /**
+   * Return true if a bounding box overlaps the node area.
+   * Consistent with contains(): a box containing a position overlaps the
+   * node containing it.
+   * @param box center
+   * @param box half size
+   */
+  inline bool overlaps(const Point& p, Coordinate r) const {
+    return p.x - r < _area.right && p.x + r >= _area.left
+        && p.y - r < _area.bottom && p.y + r >= _area.top;
+  }
+
+  /**
+   * Index of the child whose quadrant holds a position. Quadrants share the
+   * borders of contains(), and the outer ones extend past the node area.
+   */
+  inline unsigned int _quadrant(const Point& p) const {
+    return (unsigned(p.y >= _center.y) << 1) | unsigned(p.x >= _center.x);
   }
 
   /**
    * Return true if the position is in the node area
    */
-  inline bool contains(const Position& p) const {
-    return _area.contains(sf::Vector2i(p));
+  inline bool contains(const Point& p) const {
+    return p.x >= _area.left && p.x < _area.right && p.y >= _area.top && p.y < _area.bottom;
+  }
+
+  /**
+   * Return true if an insertion from the root would descend into the node:
+   * the node area, extended past the root borders it shares
+   * @param position
+   * @param root area
+   */
+  inline bool holds(const Point& p, const Area& root) const {
+    return (p.x >= _area.left || _area.left == root.left) && (p.x < _area.right || _area.right == root.right)
+        && (p.y >= _area.top || _area.top == root.top) && (p.y < _area.bottom || _area.bottom == root.bottom);
   }
 };
 
+// Quadtree with float bounds, used by the application
+using Node = BasicNode<float>;
+
+// Quadtree with fixed-point bounds, for worlds far from the origin
+using FixedNode = BasicNode<Fixed>;
+
 #endif
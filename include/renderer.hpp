@@ -0,0 +1,69 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <SFML/Graphics.hpp>
+#include "particles.hpp"
+#include "simulation.hpp"
+
+/**
+ * Batched rendering: particles and the spatial index are written in vertex
+ * arrays updated in place at each frame, then drawn in 3 calls.
+ * The arrays are a snapshot of the simulation: once updated, they can be
+ * drawn while the simulation moves on.
+ */
+class Renderer {
+public:
+  /**
+   * Constructor
+   */
+  Renderer();
+
+  /**
+   * Take a snapshot of particles and of the non-empty index leaves
+   * @param particles
+   * @param spatial index
+   * @param interpolation between the previous and current positions
+   */
+  void update(const Particles& particles, const SpatialIndex& index, float alpha = 1);
+
+  /**
+   * Draw the last snapshot
+   * @param render target
+   */
+  void draw(sf::RenderTarget& target) const;
+
+private:
+  // One quad per particle
+  sf::VertexArray _particles;
+
+  // Index leaves outlines
+  sf::VertexArray _lines;
+
+  // Index leaves fillings
+  sf::VertexArray _quads;
+};
+
+#endif
@@ -0,0 +1,334 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <utility>
+#include <vector>
+#include <SFML/Graphics/Rect.hpp>
+#include "config.hpp"
+#include "impulses.hpp"
+#include "quadtree.hpp"
+#include "linear_quadtree.hpp"
+#include "grid.hpp"
+#include "hash_grid.hpp"
+#include "loose_quadtree.hpp"
+#include "spatial_index.hpp"
+#include "narrowphase.hpp"
+#include "pair_cache.hpp"
+#include "particles.hpp"
+#include "sweep_and_prune.hpp"
+#include "tuner.hpp"
+#include "workers.hpp"
+
+// Spatial index, chosen with the SPATIAL_INDEX CMake option
+#if defined(LINEAR_QUADTREE)
+using SpatialIndex = LinearQuadtree;
+#define SPATIAL_INDEX_NAME "linear"
+#elif defined(FIXED_QUADTREE)
+using SpatialIndex = FixedNode;
+#define SPATIAL_INDEX_NAME "fixed"
+#elif defined(UNIFORM_GRID)
+using SpatialIndex = Grid;
+#define SPATIAL_INDEX_NAME "grid"
+#elif defined(HASHED_GRID)
+using SpatialIndex = HashGrid;
+#define SPATIAL_INDEX_NAME "hash"
+#elif defined(LOOSE_QUADTREE)
+using SpatialIndex = LooseQuadtree;
+#define SPATIAL_INDEX_NAME "loose"
+#else
+using SpatialIndex = Node;
+#define SPATIAL_INDEX_NAME "node"
+#endif
+
+/**
+ * Particles, their spatial index and the collision passes, without any window:
+ * shared by the application and the benchmarks.
+ */
+class Simulation {
+public:
+  // Counters of the last collision pass
+  struct Stats {
+    unsigned long pairsTested;
+    unsigned long pairsColliding;
+  };
+
+  /**
+   * Constructor
+   * @param settings
+   * @param playable area, also covered by the index
+   */
+  Simulation(const Config& config, const sf::Rect<int>& area);
+
+  /**
+   * Destructor
+   */
+  ~Simulation();
+
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  /**
+   * Advance by fixed time steps, as many as fit in the elapsed time plus the
+   * remainder of the last call, up to Config::maxSteps. Beyond, the late time
+   * is dropped so that a slow frame does not slow down the next ones.
+   * @param real time since last call, in seconds
+   * @return number of steps run
+   */
+  unsigned int advance(double elapsed);
+
+  /**
+   * Advance one step: move particles, update the index, handle collisions
+   * @param time step in seconds
+   */
+  void step(double dt);
+
+  /**
+   * Move particles
+   * @param time since last update
+   */
+  void update(double dt);
+
+  /**
+   * Rebuild or update the index from particle positions
+   */
+  void build();
+
+  /**
+   * Find and handle collisions
+   */
+  void resolveCollisions();
+
+  /**
+   * Add a particle, at any time between two steps
+   * @param position
+   * @param velocity
+   * @param radius in pixel
+   * @return handle on the particle
+   */
+  Particles::Handle spawn(const sf::Vector2f& position, const sf::Vector2f& velocity, float r);
+
+  /**
+   * Remove a particle, at any time between two steps. The index is updated
+   * in place: with Config::incremental, it is not rebuilt. Its contacts end
+   * in the events of the next collision pass.
+   * @param handle
+   * @return false if the handle was stale
+   */
+  bool despawn(Particles::Handle handle);
+
+  /**
+   * Getter for particles
+   */
+  inline Particles& getParticles() {
+    return _particles;
+  }
+
+  /**
+   * Getter for the spatial index
+   */
+  inline SpatialIndex& getIndex() {
+    return *_index;
+  }
+
+  /**
+   * Getter for the playable area
+   */
+  inline const sf::Rect<int>& getArea() const {
+    return _area;
+  }
+
+  /**
+   * Getter for the number of steps simulated so far
+   */
+  inline unsigned long getSteps() const {
+    return _steps;
+  }
+
+  /**
+   * Getter for the position of the current time between the last two steps,
+   * to interpolate rendering
+   * @return 0 at the previous step, 1 at the last one
+   */
+  inline float getAlpha() const {
+    return _accumulator / _config.timeStep;
+  }
+
+  /**
+   * Getter for the contact events of the last collision pass, with
+   * Config::contacts. Particles are named by their slot, which does not
+   * change when other particles are removed.
+   */
+  inline const std::vector<PairCache::Contact>& getContacts() const {
+    return _contacts.getEvents();
+  }
+
+  /**
+   * Getter for the counters of the last collision pass
+   */
+  inline const Stats& getStats() const {
+    return _stats;
+  }
+
+private:
+  using Pair = std::pair<unsigned int, unsigned int>;
+
+  // Contact found along the motion of two particles, with Config::continuous
+  struct Impact {
+    float time;
+    unsigned int first;
+    unsigned int second;
+  };
+
+  // Pairs found by a worker in a chunk of leaves, or of sorted particles
+  struct Chunk {
+    unsigned int worker;
+    unsigned int begin;
+    unsigned int end;
+    unsigned long tested;
+  };
+
+  /**
+   * Update or rebuild the index
+   * @template particles, or their motions with Config::continuous
+   * @param elements to index
+   */
+  template<typename T>
+  void _build(const T& entities) {
+    if (_config.incremental)
+      _index->update(entities, entities.size());
+    else if (_workers != nullptr)
+      _index->build(entities, entities.size(), *_workers);
+    else
+      _index->build(entities, entities.size());
+  }
+
+  /**
+   * Find colliding pairs in a chunk of leaves (parallel pass)
+   * @param worker index
+   * @param chunk index
+   */
+  void _detect(unsigned int worker, unsigned int chunk);
+
+  /**
+   * Find colliding pairs of a chunk of particles sorted along x (parallel
+   * pass of the sweep broad phase)
+   * @param worker index
+   * @param chunk index
+   */
+  void _detectSweep(unsigned int worker, unsigned int chunk);
+
+  /**
+   * Find and handle collisions with the sweep broad phase (serial pass)
+   */
+  void _sweepCollisions();
+
+  /**
+   * Tell whether a leaf is in charge of a colliding pair.
+   * With Insertion::Bounds, a pair can be found in several leaves: only the
+   * one containing the top-left corner of the intersection of the bounding
+   * boxes handles it.
+   * @param leaf where the pair was found
+   * @param a particle
+   * @param another particle
+   */
+  bool _owns(SpatialIndex::Leaf leaf, unsigned int i, unsigned int j);
+
+  /**
+   * Get the elements of a leaf, followed by the elements of other leaves to
+   * test them against (loose quadtree)
+   * @param leaf
+   * @param buffer receiving both, if there are other elements
+   * @param output array
+   * @param output size, including other elements
+   * @return number of elements of the leaf itself
+   */
+  unsigned int _candidates(SpatialIndex::Leaf leaf, std::vector<unsigned int>* buffer,
+                           unsigned int** elements, unsigned int* total);
+
+  /**
+   * Respond to a colliding pair. With Config::continuous, pairs are
+   * candidates whose motions overlap, and contacts are only recorded, to be
+   * resolved by _endPass(). Impulses are also applied by _endPass().
+   * @param a particle
+   * @param another particle
+   * @return false if the particles did not meet
+   */
+  bool _respond(unsigned int i, unsigned int j);
+
+  /**
+   * Resolve the impacts recorded by the collision pass, earliest first, or
+   * apply its impulses, close its contacts and publish its counters to the
+   * profiler
+   */
+  void _endPass();
+
+  Config _config;
+  sf::Rect<int> _area;
+  Particles _particles;
+  SpatialIndex* _index;
+  std::vector<SpatialIndex::Leaf> _leaves;
+
+  // Candidates of a leaf, per worker (the serial pass uses the first one)
+  std::vector<std::vector<unsigned int>> _neighbors;
+
+  // Broad phase with BroadPhase::Sweep, instead of the index
+  SweepAndPrune _sweep;
+
+  // Contacts across frames, with Config::contacts
+  PairCache _contacts;
+
+  // Responses of the collision pass, with Response::Impulse
+  Impulses _impulses;
+  Stats _stats;
+
+  // Time not simulated yet, less than a step
+  double _accumulator;
+
+  // Duration of the last update, continued after impacts
+  double _lastStep;
+
+  // Impacts of the collision pass, and particles already resolved
+  std::vector<Impact> _impacts;
+  std::vector<std::uint8_t> _impacted;
+
+  // Steps simulated so far
+  unsigned long _steps;
+
+  // Capacity tuning, with --auto-capacity
+  CapacityTuner _tuner;
+
+  // Narrow phase of the serial pass
+  NarrowPhase _narrowPhase;
+
+  // Parallel collision pass, null for the serial path
+  Workers* _workers;
+  Workers::Task _detectTask;
+  std::vector<NarrowPhase> _narrowPhases;
+  std::vector<std::vector<Pair>> _pairs;
+  std::vector<Chunk> _chunks;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+#include <SFML/Graphics/Rect.hpp>
+#include "particles.hpp"
+
+/**
+ * Binary capture of the particles, to replay a frame offline.
+ * A header is followed by one array of 32-bit floats per attribute (x, y,
+ * vx, vy, radius), in native byte order. Every array starts on a 4-byte
+ * boundary, so that a mapped file can be read in place.
+ */
+struct Snapshot {
+  // Start of every snapshot
+  static constexpr std::uint32_t MAGIC = 0x4E535451;
+  static constexpr std::uint32_t VERSION = 2;
+
+  struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+
+    // Number of particles
+    std::uint32_t count;
+
+    // Playable area
+    std::uint32_t width;
+    std::uint32_t height;
+
+    // Simulation steps per second, so that a replay steps the same way
+    std::uint32_t rate;
+
+    // Steps simulated before the capture
+    std::uint64_t steps;
+  };
+
+  /**
+   * Write the particles to a file
+   * @param path
+   * @param particles
+   * @param playable area
+   * @param steps simulated so far
+   * @param duration of a step, in seconds
+   * @return false if the file cannot be written
+   */
+  static bool save(const std::string& path, const Particles& particles, const sf::Rect<int>& area,
+                   std::uint64_t steps, double timeStep);
+
+  /**
+   * Replace the particles by the ones of a file, mapped in memory
+   * @param path
+   * @param particles, cleared first
+   * @param header read, for the area, the step rate and the step count
+   * @return false if the file cannot be read or is not a snapshot
+   */
+  static bool load(const std::string& path, Particles* particles, Header* header);
+};
+
+#endif
@@ -0,0 +1,242 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <algorithm>
+#include <SFML/Graphics.hpp>
+#include "quadtree.hpp"
+
+/**
+ * Queries written once for all spatial indexes: Node and FixedNode,
+ * LinearQuadtree, Grid, HashGrid and LooseQuadtree. An index partitions
+ * elements in leaves and provides:
+ *
+ *   Index(const sf::Rect<int>& area)
+ *   Leaf                                      leaf handle
+ *   setInsertion(Insertion), getInsertion(), setCapacity(unsigned int)
+ *   setMergeThreshold(unsigned int), setMaxDepth(unsigned int)
+ *   setLooseness(float)
+ *   add(entities, id), build(entities, count), update(entities, count)
+ *   build(entities, count, workers)           build on several threads, or
+ *                                             serial build
+ *   erase(id, last)                           removal by swap-and-pop, before
+ *                                             the next update()
+ *   getLeaves(std::vector<Leaf>*), getElements(Leaf, unsigned int**)
+ *   getNeighbors(Leaf, std::vector<unsigned int>*)
+ *                                             elements of other leaves to
+ *                                             test against the leaf ones
+ *   locate(position)                          leaf containing a position,
+ *                                             clamped to the index
+ *   forEachLeaf(rectangle, f)                 leaves overlapping a rectangle
+ *   draw(lines, quads), clear(), size(), depth()
+ *
+ * Entities are read through entities[id].getPosition(), and getRadius()
+ * with Insertion::Bounds, where an element is stored in every leaf its
+ * bounding box overlaps. Results are then deduplicated by ownership: among
+ * the leaves where two boxes meet, only the one containing the top-left
+ * corner of their intersection reports them. With Insertion::Loose, an
+ * element is stored once, and pairs spanning two leaves are reported by the
+ * one whose getNeighbors() returns the other leaf elements.
+ */
+struct Spatial {
+  /**
+   * Bounding box of an element
+   * @param entities
+   * @param element index
+   */
+  template<typename T>
+  static inline sf::FloatRect bounds(const T& entities, unsigned int id) {
+    const sf::Vector2f p = entities[id].getPosition();
+    const float r = entities[id].getRadius();
+    return sf::FloatRect(p.x - r, p.y - r, 2*r, 2*r);
+  }
+
+  /**
+   * Tell whether two boxes meet, borders included
+   */
+  static inline bool meet(const sf::FloatRect& a, const sf::FloatRect& b) {
+    return a.left <= b.left + b.width && b.left <= a.left + a.width
+        && a.top <= b.top + b.height && b.top <= a.top + a.height;
+  }
+
+  /**
+   * Tell whether a leaf is in charge of two meeting boxes
+   * @param index
+   * @param leaf where both boxes were found
+   * @param a box
+   * @param another box
+   */
+  template<typename Index>
+  static inline bool owns(Index& index, typename Index::Leaf leaf,
+                          const sf::FloatRect& a, const sf::FloatRect& b) {
+    return index.locate(sf::Vector2f(std::max(a.left, b.left), std::max(a.top, b.top))) == leaf;
+  }
+
+  /**
+   * Visit the elements in a rectangle, borders included: by their position
+   * with Insertion::Point, by their bounding box otherwise
+   * @param index
+   * @param entities
+   * @param rectangle
+   * @param function called once with each element index
+   */
+  template<typename Index, typename T, typename F>
+  static void queryRect(Index& index, const T& entities, const sf::FloatRect& r, const F& visit) {
+    const bool points = index.getInsertion() == Insertion::Point;
+    const bool loose = index.getInsertion() == Insertion::Loose;
+
+    index.forEachLeaf(r, [&](typename Index::Leaf leaf) {
+      unsigned int* elements;
+      unsigned int n = index.getElements(leaf, &elements);
+
+      for (unsigned int i=0; i<n; i++) {
+        if (points) {
+          const sf::Vector2f p = entities[elements[i]].getPosition();
+          if (p.x >= r.left && p.x <= r.left + r.width && p.y >= r.top && p.y <= r.top + r.height)
+            visit(elements[i]);
+        }
+        else {
+          const sf::FloatRect box = bounds(entities, elements[i]);
+          if (meet(r, box) && (loose || owns(index, leaf, r, box)))
+            visit(elements[i]);
+        }
+      }
+    });
+  }
+
+  /**
+   * Visit the elements in a disk: by their position with Insertion::Point,
+   * overlapping it otherwise
+   * @param index
+   * @param entities
+   * @param disk center
+   * @param disk radius
+   * @param function called once with each element index
+   */
+  template<typename Index, typename T, typename F>
+  static void queryRadius(Index& index, const T& entities, const sf::Vector2f& center, float radius,
+                          const F& visit) {
+    const bool points = index.getInsertion() == Insertion::Point;
+
+    queryRect(index, entities, sf::FloatRect(center.x - radius, center.y - radius, 2*radius, 2*radius),
+              [&](unsigned int id) {
+      const sf::Vector2f d = entities[id].getPosition() - center;
+      const float r = points ? radius : radius + entities[id].getRadius();
+
+      if (d.x*d.x + d.y*d.y <= r*r)
+        visit(id);
+    });
+  }
+
+  /**
+   * Find the elements in a rectangle, see the visitor version
+   * @param index
+   * @param entities
+   * @param rectangle
+   * @param output buffer
+   * @param output buffer size
+   * @return number of elements found, only the first ones are written if it
+   *         exceeds the buffer size
+   */
+  template<typename Index, typename T>
+  static unsigned int queryRect(Index& index, const T& entities, const sf::FloatRect& r,
+                                unsigned int* out, unsigned int capacity) {
+    unsigned int count = 0;
+
+    queryRect(index, entities, r, [&](unsigned int id) {
+      if (count < capacity)
+        out[count] = id;
+      count++;
+    });
+
+    return count;
+  }
+
+  /**
+   * Find the elements in a disk, see the visitor version
+   * @param index
+   * @param entities
+   * @param disk center
+   * @param disk radius
+   * @param output buffer
+   * @param output buffer size
+   * @return number of elements found, only the first ones are written if it
+   *         exceeds the buffer size
+   */
+  template<typename Index, typename T>
+  static unsigned int queryRadius(Index& index, const T& entities, const sf::Vector2f& center, float radius,
+                                  unsigned int* out, unsigned int capacity) {
+    unsigned int count = 0;
+
+    queryRadius(index, entities, center, radius, [&](unsigned int id) {
+      if (count < capacity)
+        out[count] = id;
+      count++;
+    });
+
+    return count;
+  }
+
+  /**
+   * Visit the candidate pairs: elements sharing a leaf, or a leaf and its
+   * neighbors, with overlapping bounding boxes unless Insertion::Point. The
+   * narrow phase is left to the caller.
+   * @param index
+   * @param entities
+   * @param leaves, from getLeaves()
+   * @param function called once with each pair of element indexes
+   */
+  template<typename Index, typename T, typename F>
+  static void forEachPair(Index& index, const T& entities,
+                          const std::vector<typename Index::Leaf>& leaves, const F& visit) {
+    const bool points = index.getInsertion() == Insertion::Point;
+    const bool loose = index.getInsertion() == Insertion::Loose;
+    std::vector<unsigned int> neighbors;
+
+    for (auto leaf: leaves) {
+      unsigned int* elements;
+      unsigned int n = index.getElements(leaf, &elements);
+
+      neighbors.clear();
+      index.getNeighbors(leaf, &neighbors);
+
+      for (unsigned int i=0; i<n; i++)
+        for (unsigned int j=i+1; j<n+neighbors.size(); j++) {
+          const unsigned int other = j < n ? elements[j] : neighbors[j-n];
+
+          if (not points) {
+            const sf::FloatRect a = bounds(entities, elements[i]);
+            const sf::FloatRect b = bounds(entities, other);
+            if (not meet(a, b) || not (loose || owns(index, leaf, a, b)))
+              continue;
+          }
+
+          visit(elements[i], other);
+        }
+    }
+  }
+};
+
+#endif
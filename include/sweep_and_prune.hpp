@@ -0,0 +1,86 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef SWEEP_AND_PRUNE_HPP
+#define SWEEP_AND_PRUNE_HPP
+
+#include <vector>
+#include "particles.hpp"
+
+/**
+ * Sort-and-sweep broad phase along x. Particles are kept sorted by the left
+ * side of their bounding box: as they move little between frames, an
+ * insertion sort of last frame order runs in almost linear time. The sweep
+ * then gives, for each particle, the run of following particles whose
+ * interval on x overlaps its own: the candidates of the narrow phase.
+ */
+class SweepAndPrune {
+  using EntityId = unsigned int;
+
+public:
+  /**
+   * Constructor
+   */
+  SweepAndPrune():_intervals(), _ids(), _ends() {}
+
+  /**
+   * Sort particles and find the overlapping runs
+   * @param particles
+   * @param true to sort the intervals covered during the last update
+   */
+  void update(const Particles& particles, bool swept = false);
+
+  /**
+   * Getter for the particles, sorted along x
+   */
+  inline const std::vector<EntityId>& getOrder() const {
+    return _ids;
+  }
+
+  /**
+   * Getter for the end of the candidates of each sorted particle: the
+   * candidates of the k-th particle are the sorted ones in (k, end[k])
+   */
+  inline const std::vector<unsigned int>& getEnds() const {
+    return _ends;
+  }
+
+private:
+  // Interval of a particle on x
+  struct Interval {
+    float min;
+    float max;
+    EntityId id;
+  };
+
+  // Particles sorted by the left side of their box, kept between frames
+  std::vector<Interval> _intervals;
+
+  // Sorted particle indices, contiguous for the narrow phase
+  std::vector<EntityId> _ids;
+
+  // End of the run of overlapping particles
+  std::vector<unsigned int> _ends;
+};
+
+#endif
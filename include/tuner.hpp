@@ -0,0 +1,118 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef TUNER_HPP
+#define TUNER_HPP
+
+#include <algorithm>
+#include <cmath>
+
+// Frames averaged before each capacity change
+#define TUNER_WINDOW 16
+
+// Capacity factor of each change
+#define TUNER_STEP 1.25
+
+#define TUNER_MIN_CAPACITY 2
+#define TUNER_MAX_CAPACITY 256
+
+/**
+ * Leaf capacity tuning by hill climbing. Larger leaves make the build
+ * cheaper and the pair tests more expensive: the build and collision times
+ * are averaged over a window of frames, the capacity first moves toward the
+ * most expensive of both, and keeps its direction while the total cost
+ * decreases.
+ */
+class CapacityTuner {
+public:
+  /**
+   * Constructor
+   * @param initial capacity
+   */
+  CapacityTuner(unsigned int capacity):
+    _capacity(capacity), _direction(0), _frames(0), _build(0), _collide(0), _lastCost(0) {}
+
+  /**
+   * Record the cost of a frame
+   * @param tree build time
+   * @param collision pass time
+   * @return true if the capacity changed
+   */
+  bool record(double build, double collide) {
+    _build += build;
+    _collide += collide;
+
+    if (++_frames < TUNER_WINDOW)
+      return false;
+
+    const double cost = _build + _collide;
+
+    // Fewer pairs to test with smaller leaves, fewer nodes with larger ones
+    if (_direction == 0)
+      _direction = _collide > _build ? -1 : 1;
+    else if (cost > _lastCost)
+      _direction = -_direction;
+
+    _lastCost = cost;
+    _frames = 0;
+    _build = 0;
+    _collide = 0;
+
+    const double factor = _direction > 0 ? TUNER_STEP : 1 / TUNER_STEP;
+    const unsigned int capacity = std::min<unsigned int>(TUNER_MAX_CAPACITY,
+      std::max<unsigned int>(TUNER_MIN_CAPACITY, std::lround(_capacity * factor)));
+
+    // At least one unit, so that small capacities can move too
+    const unsigned int next = capacity != _capacity ? capacity
+      : std::min(TUNER_MAX_CAPACITY, std::max(TUNER_MIN_CAPACITY, int(_capacity) + _direction));
+
+    if (next == _capacity)
+      return false;
+
+    _capacity = next;
+    return true;
+  }
+
+  /**
+   * Getter for the current capacity
+   */
+  inline unsigned int getCapacity() const {
+    return _capacity;
+  }
+
+private:
+  unsigned int _capacity;
+
+  // 1 to grow leaves, -1 to shrink them, 0 before the first window
+  int _direction;
+
+  // Frames and times in the current window
+  unsigned int _frames;
+  double _build;
+  double _collide;
+
+  // Cost of the last window
+  double _lastCost;
+};
+
+#endif
@@ -26,6 +26,7 @@ SOFTWARE. */
 #include <SFML/Graphics.hpp>
 #include <cstdlib>
 #include <ctime>
+#include <random>
 #include "constants.hpp"
 #include <cmath>
 
@@ -55,15 +56,46 @@ struct Utils {
 
     return u/n;
   }
+
+  /**
+   * Append a rectangle to batched vertex arrays
+   * @param line list receiving the outline
+   * @param quad list receiving the filling
+   * @param rectangle
+   * @param outline color
+   * @param fill color
+   */
+  static void rectangle(sf::VertexArray* lines, sf::VertexArray* quads, const sf::FloatRect& r,
+                        const sf::Color& outline, const sf::Color& fill) {
+    const sf::Vector2f corners[4] = {
+      sf::Vector2f(r.left, r.top),
+      sf::Vector2f(r.left + r.width, r.top),
+      sf::Vector2f(r.left + r.width, r.top + r.height),
+      sf::Vector2f(r.left, r.top + r.height)
+    };
+
+    for (int i=0; i<4; i++) {
+      lines->append(sf::Vertex(corners[i], outline));
+      lines->append(sf::Vertex(corners[(i+1)%4], outline));
+      quads->append(sf::Vertex(corners[i], fill));
+    }
+  }
 };
 
 
 struct Random {
   /**
-   * Init randomizer
+   * Init randomizer. The same seed gives the same sequence on every
+   * platform, unlike rand().
+   * @param seed, 0 for a seed from the clock
+   * @return seed used
    */
-  static void init() {
-    srand(time(0));
+  static unsigned int init(unsigned int seed = 0) {
+    if (seed == 0)
+      seed = time(0);
+
+    _engine().seed(seed);
+    return seed;
   }
 
   /**
@@ -72,22 +104,40 @@ struct Random {
    * @param maximum Y coordinate
    */
   static sf::Vector2f position(int xMax, int yMax) {
-    int x = rand() % xMax;
-    int y = rand() % yMax;
+    int x = _engine()() % xMax;
+    int y = _engine()() % yMax;
 
     return sf::Vector2f(x,y);
   }
 
+  /**
+   * Creates a random integer in [0,max)
+   * @param upper bound
+   */
+  static unsigned int integer(unsigned int max) {
+    return _engine()() % max;
+  }
+
   /**
    * Creates a random velocity
+   * @return pixels per second
    */
   static sf::Vector2f velocity() {
-    int e = rand()%2 == 0 ? 1:-1;
-    int f = rand()%2 == 0 ? 1:-1;
-    int x = 3 + rand() % 3;
-    int y = 3 + rand() % 3;
+    int e = _engine()()%2 == 0 ? 1:-1;
+    int f = _engine()()%2 == 0 ? 1:-1;
+    int x = 3 + _engine()() % 3;
+    int y = 3 + _engine()() % 3;
+
+    return sf::Vector2f(e*x,f*y) * float(FRAME_RATE);
+  }
 
-    return sf::Vector2f(e*x,f*y);
+private:
+  /**
+   * Generator shared by all draws
+   */
+  static std::mt19937& _engine() {
+    static std::mt19937 engine;
+    return engine;
   }
 };
 
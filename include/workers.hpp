@@ -0,0 +1,109 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#ifndef WORKERS_HPP
+#define WORKERS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of persistent threads running indexed tasks.
+ * Each worker first consumes its own contiguous range of items, then steals
+ * remaining items from the other ranges, so uneven items are balanced.
+ */
+class Workers {
+public:
+  using Task = std::function<void(unsigned int worker, unsigned int item)>;
+
+  /**
+   * Constructor
+   * @param number of workers, including the calling thread
+   */
+  Workers(unsigned int count);
+
+  /**
+   * Destructor
+   */
+  ~Workers();
+
+  Workers(const Workers&) = delete;
+  Workers& operator=(const Workers&) = delete;
+
+  /**
+   * Run a task on items [0, count) and wait for completion.
+   * The calling thread takes part as worker 0.
+   * @param number of items
+   * @param task called once per item
+   */
+  void run(unsigned int count, const Task& task);
+
+  /**
+   * Getter for the number of workers
+   * @return workers, including the calling thread
+   */
+  inline unsigned int size() const {
+    return _queues.size();
+  }
+
+private:
+  // Range of items assigned to a worker, consumed by it and by thieves
+  struct alignas(64) Queue {
+    std::atomic<unsigned int> next;
+    unsigned int end;
+  };
+
+  std::vector<Queue> _queues;
+  std::vector<std::thread> _threads;
+
+  std::mutex _mutex;
+  std::condition_variable _start;
+  std::condition_variable _done;
+
+  // Incremented for each run, to wake up the threads
+  unsigned long _generation;
+
+  // Threads still working on the current run
+  unsigned int _running;
+
+  bool _stop;
+  const Task* _task;
+
+  /**
+   * Thread main loop
+   * @param worker index
+   */
+  void _loop(unsigned int worker);
+
+  /**
+   * Consume own items then steal from the others
+   * @param worker index
+   */
+  void _work(unsigned int worker);
+};
+
+#endif
@@ -20,73 +20,130 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE. */
 
+
+#include <cstdio>
+#include <iostream>
 #include "app.hpp"
-#include "quadtree.hpp"
 #include "constants.hpp"
+#include "profiler.hpp"
+#include "snapshot.hpp"
 #include "utils.hpp"
 
-App::App() {
+App::App(const Config& config):
+#ifdef ENABLE_PROFILER
+  _overlay(true), _hasFont(false),
+#endif
+  _config(config), _spawning(0), _saving(false), _published(0), _displayed(0), _running(false) {
+  // Printed, so that a run can be reproduced with --seed
+  std::cout << "Seed: " << Random::init(_config.seed) << std::endl;
+
   // Create SFML window
-  Random::init();
   _window = new sf::RenderWindow(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "app");
   _window->setActive(false);
-  _window->setFramerateLimit(30);
-
-  for(auto& entity: _entities) {
-    entity.init(1, sf::Color(0x33CC00), sf::Color::Green, 1);
-    entity.setPlayableArea(sf::FloatRect(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
-    entity.move(Random::velocity());
-  }
-
-  _quadtree = new Node(sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+  _window->setFramerateLimit(FRAME_RATE);
+
+  _simulation = new Simulation(_config, sf::Rect<int>(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
+
+  for (unsigned int i=0; i<_config.entities; i++)
+    _simulation->spawn(Random::position(WINDOW_WIDTH, WINDOW_HEIGHT) + STARTING_OFFSET,
+                       Random::velocity(), ENTITY_RADIUS);
+
+#ifdef ENABLE_PROFILER
+  // Without font, the overlay only shows bars
+  _hasFont = _font.loadFromFile(OVERLAY_FONT);
+  _text.setFont(_font);
+  _text.setCharacterSize(14);
+  _text.setFillColor(sf::Color::White);
+  _text.setPosition(10, 10);
+#endif
 }
 
 App::~App() {
-  delete _quadtree;
+  delete _simulation;
   delete _window;
 }
 
 void App::render() {
+    PROFILE_SCOPE("render");
+    _renderers[0].update(_simulation->getParticles(), _simulation->getIndex(), _simulation->getAlpha());
+    _display(_renderers[0]);
+}
+
+void App::_display(const Renderer& renderer) {
     _window->clear();
 
-    for(auto& entity: _entities)
-      _window->draw(entity.getShape());
+    renderer.draw(*_window);
 
-    _quadtree->draw(_window);
+#ifdef ENABLE_PROFILER
+    if (_overlay)
+      _drawOverlay();
+#endif
 
     _window->display();
 }
 
-void App::resolveCollisions() {
+#ifdef ENABLE_PROFILER
+void App::_drawOverlay() {
+  const Profiler& profiler = Profiler::get();
+  std::string lines;
+  char line[64];
+
+  // One bar per phase, 20 pixels per millisecond
+  sf::RectangleShape bar;
+  float y = 10;
+
+  for (auto& phase: profiler.getPhases()) {
+    std::snprintf(line, sizeof(line), "%-12s %7.2f ms\n", phase.name, phase.duration / 1000.0);
+    lines += line;
+
+    bar.setPosition(200, y + 4);
+    bar.setSize(sf::Vector2f(phase.duration / 50.0f, 10));
+    bar.setFillColor(sf::Color(0xFF, 0x99, 0x00, 0xCC));
+    _window->draw(bar);
+    y += 17;
+  }
 
-  // Retrieve all leaves from the quadtree
-  std::vector<Node*> leaves;
-  _quadtree->getLeaves(&leaves);
+  for (auto& counter: profiler.getCounters()) {
+    std::snprintf(line, sizeof(line), "%-16s %10.0f\n", counter.name, counter.value);
+    lines += line;
+  }
 
-  // For each leaf...
-  for (auto leaf: leaves) {
+  if (profiler.isTracing())
+    lines += "recording trace (T to stop)\n";
 
-    // ... get the associated objects
-    unsigned int* elements;
-    unsigned int nbEntities = leaf->getElements(&elements);
+  if (_hasFont) {
+    _text.setString(lines);
+    _window->draw(_text);
+  }
+}
+#endif
+
+void App::update(double dt) {
+  // Applied here, on the thread owning the simulation in pipelined mode
+  int spawning = _spawning.exchange(0);
+  Particles& particles = _simulation->getParticles();
+
+  if (_saving.exchange(false)) {
+    if (Snapshot::save(_config.snapshot, particles, _simulation->getArea(), _simulation->getSteps(),
+                       _config.timeStep))
+      std::cout << "Snapshot written to " << _config.snapshot << std::endl;
+    else
+      std::cerr << "Cannot write snapshot to " << _config.snapshot << std::endl;
+  }
 
-    // Test collision between all objects in the leaf
-    for (unsigned int i=0; i<nbEntities; i++) {
-      Entity& e = _entities[elements[i]];
+  for (; spawning > 0; spawning--)
+    _simulation->spawn(Random::position(WINDOW_WIDTH, WINDOW_HEIGHT) + STARTING_OFFSET,
+                       Random::velocity(), ENTITY_RADIUS);
 
-      for (unsigned int j=i+1; j<nbEntities; j++) {
-        Entity& f = _entities[elements[j]];
+  // Random particles, by their handle as a game would
+  for (; spawning < 0 && particles.size() > 0; spawning++)
+    _simulation->despawn(particles.getHandle(Random::integer(particles.size())));
 
-        if (e.isColliding(f)) {
-          e.bounce(f);
-          f.bounce(e);
-        }
-      }
-    }
-  }
+  _simulation->advance(dt);
 }
 
 void App::handleEvents() {
+    PROFILE_SCOPE("events");
     sf::Event event;
   
     while (_window->pollEvent(event)) {
@@ -94,24 +151,103 @@ void App::handleEvents() {
         if (event.key.code == sf::Keyboard::Escape)
           _window->close();
 
+      // + and - spawn and despawn particles, S writes a snapshot
+      if (event.type == sf::Event::KeyPressed) {
+        if (event.key.code == sf::Keyboard::S)
+          _saving = true;
+        if (event.key.code == sf::Keyboard::Add || event.key.code == sf::Keyboard::Equal)
+          _spawning += SPAWN_BATCH;
+        if (event.key.code == sf::Keyboard::Subtract || event.key.code == sf::Keyboard::Hyphen)
+          _spawning -= SPAWN_BATCH;
+      }
+
+#ifdef ENABLE_PROFILER
+      // P toggles the overlay, T starts and stops a trace
+      if (event.type == sf::Event::KeyPressed) {
+        Profiler& profiler = Profiler::get();
+
+        if (event.key.code == sf::Keyboard::P)
+          _overlay = not _overlay;
+
+        if (event.key.code == sf::Keyboard::T) {
+          if (not profiler.isTracing())
+            profiler.startTrace();
+          else if (profiler.stopTrace(_config.trace))
+            std::cout << "Trace written to " << _config.trace << std::endl;
+          else
+            std::cerr << "Cannot write trace to " << _config.trace << std::endl;
+        }
+      }
+#endif
+
       if (event.type == sf::Event::Closed)
         _window->close();
     }
 }
 
 void App::run() {
+  if (_config.pipeline) {
+    _runPipeline();
+    return;
+  }
+
   sf::Clock clock;
 
   while(_window->isOpen()) {
+    PROFILE_FRAME();
     auto dt = clock.restart().asSeconds();
-    _quadtree->clear();
 
-    for(int i=0; i<NB_ENTITY; i++) {
-      _entities[i].update(dt);
-      _quadtree->add<Entity>(_entities, i);
-    }
-    resolveCollisions();
+    update(dt);
     render();
     handleEvents();
   }
 }
+
+void App::_simulate() {
+  sf::Clock clock;
+
+  for (unsigned long frame=1; _running.load(std::memory_order_relaxed); frame++) {
+    update(clock.restart().asSeconds());
+
+    // The buffer of frame N+1 is the one of frame N-1: wait until it is
+    // displayed. The main thread is then at most one frame behind.
+    while (_displayed.load(std::memory_order_acquire) + 2 <= frame)
+      if (not _running.load(std::memory_order_relaxed))
+        return;
+      else
+        std::this_thread::yield();
+
+    {
+      PROFILE_SCOPE("snapshot");
+      _renderers[frame % 2].update(_simulation->getParticles(), _simulation->getIndex(),
+                                   _simulation->getAlpha());
+    }
+
+    _published.store(frame, std::memory_order_release);
+  }
+}
+
+void App::_runPipeline() {
+  _running = true;
+  _simulationThread = std::thread(&App::_simulate, this);
+
+  while(_window->isOpen()) {
+    PROFILE_FRAME();
+    const unsigned long frame = _displayed.load(std::memory_order_relaxed) + 1;
+
+    // Frame N is displayed as soon as it is published
+    while (_published.load(std::memory_order_acquire) < frame)
+      std::this_thread::yield();
+
+    {
+      PROFILE_SCOPE("render");
+      _display(_renderers[frame % 2]);
+    }
+
+    _displayed.store(frame, std::memory_order_release);
+    handleEvents();
+  }
+
+  _running = false;
+  _simulationThread.join();
+}
@@ -0,0 +1,118 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+
+#include <algorithm>
+#include <cmath>
+#include "impulses.hpp"
+
+void Impulses::reset(unsigned int count) {
+  _contacts.clear();
+  _counts.assign(count, 0);
+}
+
+void Impulses::add(const Particles& particles, EntityId i, EntityId j) {
+  Contact contact{i, j, sf::Vector2f(), sf::Vector2f()};
+
+  if (not _response(particles, i, j, &contact.impulse, &contact.correction))
+    return;
+
+  _contacts.push_back(contact);
+  _counts[i]++;
+  _counts[j]++;
+}
+
+void Impulses::apply(Particles* particles) {
+  Particles& p = *particles;
+
+  for (auto& c: _contacts) {
+    // Both particles get the same share, so that momentum is conserved
+    const float share = 1.0f / std::max(_counts[c.i], _counts[c.j]);
+    const float wi = _inverseMass(p, c.i) * share;
+    const float wj = _inverseMass(p, c.j) * share;
+
+    p.vx[c.i] -= c.impulse.x * wi;
+    p.vy[c.i] -= c.impulse.y * wi;
+    p.vx[c.j] += c.impulse.x * wj;
+    p.vy[c.j] += c.impulse.y * wj;
+
+    p.x[c.i] -= c.correction.x * wi;
+    p.y[c.i] -= c.correction.y * wi;
+    p.x[c.j] += c.correction.x * wj;
+    p.y[c.j] += c.correction.y * wj;
+
+    p.hit[c.i] = 1;
+    p.hit[c.j] = 1;
+  }
+
+  _contacts.clear();
+}
+
+void Impulses::resolve(Particles* particles, EntityId i, EntityId j) const {
+  Particles& p = *particles;
+  sf::Vector2f impulse, correction;
+
+  if (not _response(p, i, j, &impulse, &correction))
+    return;
+
+  const float wi = _inverseMass(p, i);
+  const float wj = _inverseMass(p, j);
+
+  p.vx[i] -= impulse.x * wi;
+  p.vy[i] -= impulse.y * wi;
+  p.vx[j] += impulse.x * wj;
+  p.vy[j] += impulse.y * wj;
+
+  p.x[i] -= correction.x * wi;
+  p.y[i] -= correction.y * wi;
+  p.x[j] += correction.x * wj;
+  p.y[j] += correction.y * wj;
+
+  p.hit[i] = 1;
+  p.hit[j] = 1;
+}
+
+bool Impulses::_response(const Particles& particles, EntityId i, EntityId j, sf::Vector2f* impulse,
+                         sf::Vector2f* correction) const {
+  const Particles& p = particles;
+  const float dx = p.x[j] - p.x[i];
+  const float dy = p.y[j] - p.y[i];
+  const float d = std::sqrt(dx*dx + dy*dy);
+
+  // Same position: no direction to push along
+  if (d == 0)
+    return false;
+
+  // Normal from i to j
+  const sf::Vector2f n(dx/d, dy/d);
+  const float w = _inverseMass(p, i) + _inverseMass(p, j);
+
+  // Only particles getting closer exchange momentum
+  const float speed = (p.vx[j] - p.vx[i]) * n.x + (p.vy[j] - p.vy[i]) * n.y;
+  *impulse = speed < 0 ? n * (-(1 + _restitution) * speed / w) : sf::Vector2f(0, 0);
+
+  const float overlap = p.radius[i] + p.radius[j] - d;
+  *correction = n * (std::max(overlap - CORRECTION_SLOP, 0.0f) * CORRECTION_RATE / w);
+
+  return true;
+}
@@ -20,14 +20,71 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE. */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
 #include "app.hpp"
+#include "profiler.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+
+/**
+ * Run the steps following a snapshot, without window, at the step rate of
+ * the capture
+ * @param settings, with the snapshot to replay
+ * @return exit status
+ */
+static int replay(Config config) {
+  Snapshot::Header header;
+  Particles particles;
+
+  if (not Snapshot::load(config.replay, &particles, &header)) {
+    std::cerr << "Cannot read snapshot " << config.replay << std::endl;
+    return 1;
+  }
+
+  config.timeStep = 1.0 / header.rate;
+  Simulation simulation(config, sf::Rect<int>(0, 0, header.width, header.height));
+  simulation.getParticles() = particles;
+
+  std::printf("%u particles, captured after %llu steps at %u Hz\n", header.count, (unsigned long long) header.steps,
+              header.rate);
+
+#ifdef ENABLE_PROFILER
+  Profiler::get().startTrace();
+#endif
+
+  double total = 0, slowest = 0;
+  for (unsigned int frame=0; frame<config.frames; frame++) {
+    PROFILE_FRAME();
+    auto start = std::chrono::steady_clock::now();
+    simulation.step(config.timeStep);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    total += ms;
+    slowest = std::max(slowest, ms);
+  }
+
+  std::printf("%u steps: %.3f ms per step, slowest %.3f ms, %lu pairs colliding in the last one\n",
+              config.frames, total / std::max(1u, config.frames), slowest, simulation.getStats().pairsColliding);
+
+#ifdef ENABLE_PROFILER
+  if (Profiler::get().stopTrace(config.trace))
+    std::cout << "Trace written to " << config.trace << std::endl;
+#endif
+
+  return 0;
+}
 
 int main(int argc, char** argv)
 {
-  (void) argc;
-  (void) argv;
+  Config config = Config::parse(argc, argv);
+
+  if (not config.replay.empty())
+    return replay(config);
 
-  App* application = new App();
+  App* application = new App(config);
 
   application->run();
 
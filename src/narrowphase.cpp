@@ -0,0 +1,116 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include <limits>
+#include "narrowphase.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void NarrowPhase::load(const Particles& particles, const EntityId* ids, unsigned int count, bool swept) {
+  // Room for a full vector after the last candidate
+  unsigned int padded = count + NARROWPHASE_LANES;
+  const float far = std::numeric_limits<float>::max();
+
+  _count = count;
+  _x.resize(padded);
+  _y.resize(padded);
+  _r.resize(padded);
+  _out.resize(count);
+
+  if (swept)
+    for (unsigned int k=0; k<count; k++) {
+      const sf::Vector2f p = particles.getMotions()[ids[k]].getPosition();
+      _x[k] = p.x;
+      _y[k] = p.y;
+      _r[k] = particles.getSweptRadius(ids[k]);
+    }
+  else for (unsigned int k=0; k<count; k++) {
+    _x[k] = particles.x[ids[k]];
+    _y[k] = particles.y[ids[k]];
+    _r[k] = particles.radius[ids[k]];
+  }
+
+  for (unsigned int k=count; k<padded; k++) {
+    _x[k] = far;
+    _y[k] = far;
+    _r[k] = 0;
+  }
+}
+
+unsigned int NarrowPhase::collide(unsigned int i, unsigned int end, const unsigned int** out) {
+  const float xi = _x[i];
+  const float yi = _y[i];
+  const float ri = _r[i];
+  unsigned int n = 0;
+  unsigned int j = i + 1;
+
+#if NARROWPHASE_LANES > 1
+#if defined(__AVX__)
+  const __m256 x = _mm256_set1_ps(xi);
+  const __m256 y = _mm256_set1_ps(yi);
+  const __m256 r = _mm256_set1_ps(ri);
+
+  for (; j < end; j += NARROWPHASE_LANES) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&_x[j]), x);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&_y[j]), y);
+    __m256 rs = _mm256_add_ps(_mm256_loadu_ps(&_r[j]), r);
+    __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_mul_ps(rs, rs), _CMP_LT_OQ));
+#else
+  const __m128 x = _mm_set1_ps(xi);
+  const __m128 y = _mm_set1_ps(yi);
+  const __m128 r = _mm_set1_ps(ri);
+
+  for (; j < end; j += NARROWPHASE_LANES) {
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(&_x[j]), x);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(&_y[j]), y);
+    __m128 rs = _mm_add_ps(_mm_loadu_ps(&_r[j]), r);
+    __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    int mask = _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(rs, rs)));
+#endif
+    // Padding never collides, so every set lane is a real candidate,
+    // unless it is past the end
+    if (j + NARROWPHASE_LANES > end)
+      mask &= (1 << (end - j)) - 1;
+
+    for (unsigned int lane=0; mask != 0; lane++, mask >>= 1)
+      if (mask & 1)
+        _out[n++] = j + lane;
+  }
+#else
+  for (; j < end; j++) {
+    float dx = _x[j] - xi;
+    float dy = _y[j] - yi;
+    float rs = _r[j] + ri;
+    if (dx*dx + dy*dy < rs*rs)
+      _out[n++] = j;
+  }
+#endif
+
+  *out = _out.data();
+  return n;
+}
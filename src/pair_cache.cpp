@@ -0,0 +1,132 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include "pair_cache.hpp"
+
+// Initial number of slots
+#define PAIR_CACHE_SIZE 1024
+
+PairCache::PairCache():
+  _slots(PAIR_CACHE_SIZE, Slot{EMPTY, 0}), _mask(PAIR_CACHE_SIZE - 1), _keys(), _events(), _frame(0), _recorded(0) {}
+
+void PairCache::beginFrame() {
+  _frame++;
+  _events.erase(_events.begin(), _events.begin() + _recorded);
+}
+
+bool PairCache::touch(EntityId a, EntityId b) {
+  const std::uint64_t key = _key(a, b);
+  std::uint32_t slot = _home(key);
+
+  for (; _slots[slot].key != EMPTY; slot = (slot + 1) & _mask)
+    if (_slots[slot].key == key) {
+      // Also found twice in the same frame, by bounds insertion
+      if (_slots[slot].frame == _frame)
+        return false;
+
+      _slots[slot].frame = _frame;
+      _events.push_back(Contact{EntityId(key >> 32), EntityId(key), Phase::Stay});
+      return false;
+    }
+
+  _slots[slot] = Slot{key, _frame};
+  _keys.push_back(key);
+  _events.push_back(Contact{EntityId(key >> 32), EntityId(key), Phase::Begin});
+
+  // At most half full, for short probe sequences
+  if (_keys.size() * 2 > _slots.size())
+    _grow();
+
+  return true;
+}
+
+void PairCache::endFrame() {
+  for (unsigned int k=0; k<_keys.size(); ) {
+    const std::uint64_t key = _keys[k];
+    std::uint32_t slot = _home(key);
+    while (_slots[slot].key != key)
+      slot = (slot + 1) & _mask;
+
+    if (_slots[slot].frame == _frame) {
+      k++;
+      continue;
+    }
+
+    _events.push_back(Contact{EntityId(key >> 32), EntityId(key), Phase::End});
+    _erase(slot);
+    _keys[k] = _keys.back();
+    _keys.pop_back();
+  }
+
+  _recorded = _events.size();
+}
+
+void PairCache::remove(EntityId a) {
+  // Removals are rare, so the keys are scanned rather than indexed
+  for (unsigned int k=0; k<_keys.size(); ) {
+    const std::uint64_t key = _keys[k];
+    if (EntityId(key >> 32) != a && EntityId(key) != a) {
+      k++;
+      continue;
+    }
+
+    std::uint32_t slot = _home(key);
+    while (_slots[slot].key != key)
+      slot = (slot + 1) & _mask;
+
+    _events.push_back(Contact{EntityId(key >> 32), EntityId(key), Phase::End});
+    _erase(slot);
+    _keys[k] = _keys.back();
+    _keys.pop_back();
+  }
+}
+
+void PairCache::_erase(std::uint32_t slot) {
+  std::uint32_t hole = slot;
+
+  // Keys after the hole move back unless their home is between both
+  for (std::uint32_t next = (hole + 1) & _mask; _slots[next].key != EMPTY; next = (next + 1) & _mask) {
+    std::uint32_t home = _home(_slots[next].key);
+
+    if (((next - home) & _mask) >= ((next - hole) & _mask)) {
+      _slots[hole] = _slots[next];
+      hole = next;
+    }
+  }
+
+  _slots[hole].key = EMPTY;
+}
+
+void PairCache::_grow() {
+  std::vector<Slot> slots(_slots.size() * 2, Slot{EMPTY, 0});
+  _mask = slots.size() - 1;
+  _slots.swap(slots);
+
+  for (auto& s: slots)
+    if (s.key != EMPTY) {
+      std::uint32_t slot = _home(s.key);
+      while (_slots[slot].key != EMPTY)
+        slot = (slot + 1) & _mask;
+      _slots[slot] = s;
+    }
+}
@@ -0,0 +1,143 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include <cmath>
+#include "particles.hpp"
+#include "constants.hpp"
+
+Particles::EntityId Particles::add(const sf::Vector2f& position, const sf::Vector2f& velocity, float r) {
+  spawn(position, velocity, r);
+  return x.size() - 1;
+}
+
+Particles::Handle Particles::spawn(const sf::Vector2f& position, const sf::Vector2f& velocity, float r) {
+  std::uint32_t s;
+
+  if (_free.empty()) {
+    s = _slots.size();
+    _slots.push_back(Slot{0, 0});
+  }
+  else {
+    s = _free.back();
+    _free.pop_back();
+  }
+
+  _slots[s].index = x.size();
+  slot.push_back(s);
+
+  x.push_back(position.x);
+  y.push_back(position.y);
+  px.push_back(position.x);
+  py.push_back(position.y);
+  vx.push_back(velocity.x);
+  vy.push_back(velocity.y);
+  radius.push_back(r);
+  hit.push_back(0);
+
+  return Handle{s, _slots[s].generation};
+}
+
+void Particles::remove(EntityId id) {
+  const EntityId last = x.size() - 1;
+
+  // The slot is freed, and handles on it become stale
+  _slots[slot[id]].index = NO_PARTICLE;
+  _slots[slot[id]].generation++;
+  _free.push_back(slot[id]);
+
+  if (id != last) {
+    x[id] = x[last];
+    y[id] = y[last];
+    px[id] = px[last];
+    py[id] = py[last];
+    vx[id] = vx[last];
+    vy[id] = vy[last];
+    radius[id] = radius[last];
+    hit[id] = hit[last];
+    slot[id] = slot[last];
+    _slots[slot[id]].index = id;
+  }
+
+  x.pop_back();
+  y.pop_back();
+  px.pop_back();
+  py.pop_back();
+  vx.pop_back();
+  vy.pop_back();
+  radius.pop_back();
+  hit.pop_back();
+  slot.pop_back();
+}
+
+bool Particles::despawn(Handle handle) {
+  EntityId id = find(handle);
+
+  if (id == NO_PARTICLE)
+    return false;
+
+  remove(id);
+  return true;
+}
+
+void Particles::clear() {
+  while (size() > 0)
+    remove(size() - 1);
+}
+
+void Particles::update(double dt, float width, float height) {
+  const unsigned int n = size();
+  const float step = dt;
+
+  px = x;
+  py = y;
+
+  for (unsigned int i=0; i<n; i++) {
+    x[i] += vx[i] * step;
+    y[i] += vy[i] * step;
+
+    if (x[i] > width || x[i] < 1)
+      vx[i] *= -1;
+
+    if (y[i] > height || y[i] < 1)
+      vy[i] *= -1;
+  }
+}
+
+void Particles::bounce(EntityId i, EntityId j) {
+  float dx = x[i] - x[j];
+  float dy = y[i] - y[j];
+  float n = std::hypot(dx, dy);
+
+  // Same position: no direction to go away from
+  if (n == 0)
+    return;
+
+  // Each particle leaves along the line joining the centers
+  vx[i] = BOUNCE_SPEED*dx/n;
+  vy[i] = BOUNCE_SPEED*dy/n;
+  vx[j] = -vx[i];
+  vy[j] = -vy[i];
+
+  hit[i] = 1;
+  hit[j] = 1;
+}
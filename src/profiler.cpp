@@ -0,0 +1,120 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include <cstdio>
+#include <cstring>
+#include "profiler.hpp"
+
+Profiler& Profiler::get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler():
+  _origin(std::chrono::steady_clock::now()), _phases(), _counters(), _trace(),
+  _frameStart(0), _tracing(false) {}
+
+long long Profiler::now() const {
+  auto elapsed = std::chrono::steady_clock::now() - _origin;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+unsigned int Profiler::_thread() {
+  static std::atomic<unsigned int> threads(0);
+  thread_local unsigned int thread = ++threads;
+  return thread;
+}
+
+void Profiler::beginFrame() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _phases.clear();
+  _counters.clear();
+  _frameStart = now();
+}
+
+void Profiler::record(const char* name, long long start, long long duration) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _phases.push_back(Phase{name, start, duration});
+
+  if (_tracing)
+    _trace.push_back(Event{name, start, duration, 0, _thread()});
+}
+
+void Profiler::count(const char* name, double value) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  for (auto& counter: _counters)
+    if (std::strcmp(counter.name, name) == 0) {
+      counter.value = value;
+      return;
+    }
+
+  _counters.push_back(Counter{name, value});
+
+  if (_tracing)
+    _trace.push_back(Event{name, _frameStart, -1, value, _thread()});
+}
+
+std::vector<Profiler::Phase> Profiler::getPhases() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _phases;
+}
+
+std::vector<Profiler::Counter> Profiler::getCounters() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _counters;
+}
+
+void Profiler::startTrace() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _trace.clear();
+  _tracing = true;
+}
+
+bool Profiler::stopTrace(const std::string& path) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _tracing = false;
+
+  FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return false;
+
+  std::fprintf(file, "{\"traceEvents\":[");
+
+  for (unsigned int i=0; i<_trace.size(); i++) {
+    const Event& e = _trace[i];
+    std::fprintf(file, i == 0 ? "\n" : ",\n");
+
+    if (e.duration >= 0)
+      std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u}",
+                   e.name, e.time, e.duration, e.thread);
+    else
+      std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,\"args\":{\"value\":%g}}",
+                   e.name, e.time, e.value);
+  }
+
+  std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  _trace.clear();
+
+  return std::fclose(file) == 0;
+}
@@ -0,0 +1,59 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include "renderer.hpp"
+
+Renderer::Renderer():
+  _particles(sf::Quads), _lines(sf::Lines), _quads(sf::Quads) {}
+
+void Renderer::update(const Particles& particles, const SpatialIndex& index, float alpha) {
+  const unsigned int n = particles.size();
+  const sf::Color color(0x33CC00);
+
+  // Buffers keep their capacity, so no allocation once warmed up
+  _particles.resize(4*n);
+
+  for (unsigned int i=0; i<n; i++) {
+    // Quads as large as the former outlined circles
+    const float x = particles.px[i] + (particles.x[i] - particles.px[i]) * alpha;
+    const float y = particles.py[i] + (particles.y[i] - particles.py[i]) * alpha;
+    const float r = particles.radius[i] + 1;
+    const sf::Color& c = particles.hit[i] ? sf::Color::Blue : color;
+
+    sf::Vertex* quad = &_particles[4*i];
+    quad[0] = sf::Vertex(sf::Vector2f(x - r, y - r), c);
+    quad[1] = sf::Vertex(sf::Vector2f(x + r, y - r), c);
+    quad[2] = sf::Vertex(sf::Vector2f(x + r, y + r), c);
+    quad[3] = sf::Vertex(sf::Vector2f(x - r, y + r), c);
+  }
+
+  _lines.clear();
+  _quads.clear();
+  index.draw(&_lines, &_quads);
+}
+
+void Renderer::draw(sf::RenderTarget& target) const {
+  target.draw(_particles);
+  target.draw(_quads);
+  target.draw(_lines);
+}
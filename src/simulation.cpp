@@ -0,0 +1,401 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+#include "simulation.hpp"
+#include "constants.hpp"
+#include "profiler.hpp"
+
+Simulation::Simulation(const Config& config, const sf::Rect<int>& area):
+  _config(config), _area(area), _particles(), _leaves(), _stats({0, 0}), _accumulator(0), _lastStep(0), _steps(0),
+  _tuner(config.capacity), _workers(nullptr) {
+
+  _index = new SpatialIndex(area);
+  _index->setInsertion(_config.insertion);
+  _index->setCapacity(_config.capacity);
+  _index->setMergeThreshold(_config.merge);
+  _index->setMaxDepth(_config.maxDepth);
+  _index->setLooseness(_config.looseness);
+  _impulses.setRestitution(_config.restitution);
+  _neighbors.resize(1);
+
+  if (_config.threads > 1) {
+    _workers = new Workers(_config.threads);
+    _detectTask = [this](unsigned int worker, unsigned int chunk) {
+      if (_config.broadPhase == BroadPhase::Sweep)
+        _detectSweep(worker, chunk);
+      else
+        _detect(worker, chunk);
+    };
+    _narrowPhases.resize(_workers->size());
+    _neighbors.resize(_workers->size());
+    _pairs.resize(_workers->size());
+  }
+}
+
+Simulation::~Simulation() {
+  delete _workers;
+  delete _index;
+}
+
+unsigned int Simulation::advance(double elapsed) {
+  unsigned int steps = 0;
+  _accumulator += elapsed;
+
+  while (_accumulator >= _config.timeStep && steps < _config.maxSteps) {
+    step(_config.timeStep);
+    _accumulator -= _config.timeStep;
+    steps++;
+  }
+
+  if (_accumulator >= _config.timeStep)
+    _accumulator = std::fmod(_accumulator, _config.timeStep);
+
+  PROFILE_COUNT("steps", steps);
+  return steps;
+}
+
+void Simulation::step(double dt) {
+  _steps++;
+  update(dt);
+
+  if (not _config.autoCapacity) {
+    build();
+    resolveCollisions();
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  build();
+  auto built = std::chrono::steady_clock::now();
+  resolveCollisions();
+  auto end = std::chrono::steady_clock::now();
+
+  // The next build starts from scratch with the new capacity
+  if (_tuner.record(std::chrono::duration<double>(built - start).count(),
+                    std::chrono::duration<double>(end - built).count()))
+    _index->setCapacity(_tuner.getCapacity());
+
+  PROFILE_COUNT("capacity", _tuner.getCapacity());
+}
+
+Particles::Handle Simulation::spawn(const sf::Vector2f& position, const sf::Vector2f& velocity, float r) {
+  // Inserted by the next build
+  return _particles.spawn(position, velocity, r);
+}
+
+bool Simulation::despawn(Particles::Handle handle) {
+  Particles::EntityId id = _particles.find(handle);
+
+  if (id == NO_PARTICLE)
+    return false;
+
+  // Its slot may be reused by the next spawn
+  _contacts.remove(_particles.slot[id]);
+
+  // Removed the same way from both, the last particle taking the index
+  _index->erase(id, _particles.size() - 1);
+  _particles.remove(id);
+  return true;
+}
+
+void Simulation::update(double dt) {
+  PROFILE_SCOPE("update");
+  _particles.update(dt, _area.width, _area.height);
+  _lastStep = dt;
+}
+
+void Simulation::build() {
+  PROFILE_SCOPE("build");
+
+  // The index is left empty
+  if (_config.broadPhase == BroadPhase::Sweep) {
+    _sweep.update(_particles, _config.continuous);
+    return;
+  }
+
+  if (_config.continuous)
+    _build(_particles.getMotions());
+  else
+    _build(_particles);
+
+  PROFILE_COUNT("nodes", _index->size());
+  PROFILE_COUNT("max depth", _index->depth());
+}
+
+void Simulation::resolveCollisions() {
+  PROFILE_SCOPE("collisions");
+  _stats = Stats{0, 0};
+
+  if (_config.contacts)
+    _contacts.beginFrame();
+
+  // Impacts are resolved one by one
+  if (_config.response == Response::Impulse && not _config.continuous)
+    _impulses.reset(_particles.size());
+
+  const bool sweep = _config.broadPhase == BroadPhase::Sweep;
+
+  // Retrieve all leaves from the index, reusing last frame's buffer
+  _leaves.clear();
+  if (not sweep)
+    _index->getLeaves(&_leaves);
+
+  if (_workers != nullptr) {
+    // Detection is spread over the workers...
+    if (sweep)
+      _chunks.resize((_particles.size() + PARTICLES_PER_TASK - 1) / PARTICLES_PER_TASK);
+    else
+      _chunks.resize((_leaves.size() + LEAVES_PER_TASK - 1) / LEAVES_PER_TASK);
+    for (auto& pairs: _pairs)
+      pairs.clear();
+
+    _workers->run(_chunks.size(), _detectTask);
+
+    // ...and responses are applied in leaf order, as in the serial pass,
+    // so the outcome does not depend on the number of threads
+    for (auto& chunk: _chunks) {
+      for (unsigned int i=chunk.begin; i<chunk.end; i++) {
+        const Pair& pair = _pairs[chunk.worker][i];
+        if (_respond(pair.first, pair.second))
+          _stats.pairsColliding++;
+      }
+
+      _stats.pairsTested += chunk.tested;
+    }
+
+    _endPass();
+    return;
+  }
+
+  if (sweep) {
+    _sweepCollisions();
+    _endPass();
+    return;
+  }
+
+  // For each leaf...
+  for (auto leaf: _leaves) {
+
+    // ... get the associated objects, and the ones of neighbor leaves
+    unsigned int* elements;
+    unsigned int nbCandidates;
+    unsigned int nbEntities = _candidates(leaf, &_neighbors[0], &elements, &nbCandidates);
+
+    // Test collision between all objects in the leaf, and with neighbors
+    _narrowPhase.load(_particles, elements, nbCandidates, _config.continuous);
+    _stats.pairsTested += (unsigned long) nbEntities * (nbEntities - 1) / 2
+                        + (unsigned long) nbEntities * (nbCandidates - nbEntities);
+
+    for (unsigned int i=0; i<nbEntities; i++) {
+      const unsigned int* colliding;
+      unsigned int nbColliding = _narrowPhase.collide(i, &colliding);
+
+      for (unsigned int k=0; k<nbColliding; k++)
+        if (_owns(leaf, elements[i], elements[colliding[k]]) && _respond(elements[i], elements[colliding[k]]))
+          _stats.pairsColliding++;
+    }
+  }
+
+  _endPass();
+}
+
+void Simulation::_detect(unsigned int worker, unsigned int chunk) {
+  std::vector<Pair>& pairs = _pairs[worker];
+  NarrowPhase& narrowPhase = _narrowPhases[worker];
+  unsigned int first = chunk * LEAVES_PER_TASK;
+  unsigned int last = std::min<unsigned int>(first + LEAVES_PER_TASK, _leaves.size());
+
+  _chunks[chunk].worker = worker;
+  _chunks[chunk].begin = pairs.size();
+  _chunks[chunk].tested = 0;
+
+  for (unsigned int l=first; l<last; l++) {
+    unsigned int* elements;
+    unsigned int nbCandidates;
+    unsigned int nbEntities = _candidates(_leaves[l], &_neighbors[worker], &elements, &nbCandidates);
+
+    narrowPhase.load(_particles, elements, nbCandidates, _config.continuous);
+    _chunks[chunk].tested += (unsigned long) nbEntities * (nbEntities - 1) / 2
+                           + (unsigned long) nbEntities * (nbCandidates - nbEntities);
+
+    for (unsigned int i=0; i<nbEntities; i++) {
+      const unsigned int* colliding;
+      unsigned int nbColliding = narrowPhase.collide(i, &colliding);
+
+      for (unsigned int k=0; k<nbColliding; k++)
+        if (_owns(_leaves[l], elements[i], elements[colliding[k]]))
+          pairs.push_back(Pair(elements[i], elements[colliding[k]]));
+    }
+  }
+
+  _chunks[chunk].end = pairs.size();
+}
+
+void Simulation::_sweepCollisions() {
+  const std::vector<unsigned int>& order = _sweep.getOrder();
+  const std::vector<unsigned int>& ends = _sweep.getEnds();
+
+  // All particles at once: candidates are runs of the sorted order
+  _narrowPhase.load(_particles, order.data(), order.size(), _config.continuous);
+
+  for (unsigned int k=0; k<order.size(); k++) {
+    const unsigned int* colliding;
+    unsigned int nbColliding = _narrowPhase.collide(k, ends[k], &colliding);
+    _stats.pairsTested += ends[k] - k - 1;
+
+    for (unsigned int c=0; c<nbColliding; c++)
+      if (_respond(order[k], order[colliding[c]]))
+        _stats.pairsColliding++;
+  }
+}
+
+void Simulation::_detectSweep(unsigned int worker, unsigned int chunk) {
+  const std::vector<unsigned int>& order = _sweep.getOrder();
+  const std::vector<unsigned int>& ends = _sweep.getEnds();
+  std::vector<Pair>& pairs = _pairs[worker];
+  NarrowPhase& narrowPhase = _narrowPhases[worker];
+  unsigned int first = chunk * PARTICLES_PER_TASK;
+  unsigned int last = std::min<unsigned int>(first + PARTICLES_PER_TASK, order.size());
+
+  _chunks[chunk].worker = worker;
+  _chunks[chunk].begin = pairs.size();
+  _chunks[chunk].tested = 0;
+
+  // Only the particles of the chunk and their candidates are loaded
+  unsigned int end = last;
+  for (unsigned int k=first; k<last; k++)
+    end = std::max(end, ends[k]);
+
+  narrowPhase.load(_particles, order.data() + first, end - first, _config.continuous);
+
+  for (unsigned int k=first; k<last; k++) {
+    const unsigned int* colliding;
+    unsigned int nbColliding = narrowPhase.collide(k - first, ends[k] - first, &colliding);
+    _chunks[chunk].tested += ends[k] - k - 1;
+
+    for (unsigned int c=0; c<nbColliding; c++)
+      pairs.push_back(Pair(order[k], order[first + colliding[c]]));
+  }
+
+  _chunks[chunk].end = pairs.size();
+}
+
+bool Simulation::_respond(unsigned int i, unsigned int j) {
+  float time = 0;
+
+  // Overlapping motions do not mean that the particles met
+  if (_config.continuous) {
+    time = _particles.timeOfImpact(i, j);
+    if (time > 1)
+      return false;
+  }
+
+  // Persistent contacts were handled when they began
+  if (_config.contacts && not _contacts.touch(_particles.slot[i], _particles.slot[j]))
+    return true;
+
+  if (_config.continuous)
+    _impacts.push_back(Impact{time, i, j});
+  else if (_config.response == Response::Impulse)
+    _impulses.add(_particles, i, j);
+  else
+    _particles.bounce(i, j);
+
+  return true;
+}
+
+void Simulation::_endPass() {
+  if (_config.continuous) {
+    // Earliest first, ties broken by indices so that the order is total
+    std::sort(_impacts.begin(), _impacts.end(), [](const Impact& a, const Impact& b) {
+      return std::tie(a.time, a.first, a.second) < std::tie(b.time, b.first, b.second);
+    });
+
+    // Later impacts of a particle assumed it kept its course: they are left
+    // to the next steps
+    unsigned int resolved = 0;
+    _impacted.assign(_particles.size(), 0);
+
+    auto respond = [this](unsigned int i, unsigned int j) {
+      if (_config.response == Response::Impulse)
+        _impulses.resolve(&_particles, i, j);
+      else
+        _particles.bounce(i, j);
+    };
+
+    for (auto& impact: _impacts)
+      if (not _impacted[impact.first] && not _impacted[impact.second]) {
+        _particles.impact(impact.first, impact.second, impact.time, _lastStep, respond);
+        _impacted[impact.first] = 1;
+        _impacted[impact.second] = 1;
+        resolved++;
+      }
+
+    _impacts.clear();
+    PROFILE_COUNT("impacts", resolved);
+  }
+  else if (_config.response == Response::Impulse)
+    _impulses.apply(&_particles);
+
+  if (_config.contacts) {
+    _contacts.endFrame();
+    PROFILE_COUNT("contacts", _contacts.size());
+  }
+
+  PROFILE_COUNT("leaves", _leaves.size());
+  PROFILE_COUNT("pairs tested", _stats.pairsTested);
+  PROFILE_COUNT("pairs colliding", _stats.pairsColliding);
+}
+
+unsigned int Simulation::_candidates(SpatialIndex::Leaf leaf, std::vector<unsigned int>* buffer,
+                                     unsigned int** elements, unsigned int* total) {
+  unsigned int count = _index->getElements(leaf, elements);
+  *total = count;
+
+  buffer->clear();
+  if (_index->getNeighbors(leaf, buffer) > 0) {
+    buffer->insert(buffer->begin(), *elements, *elements + count);
+    *elements = buffer->data();
+    *total = buffer->size();
+  }
+
+  return count;
+}
+
+bool Simulation::_owns(SpatialIndex::Leaf leaf, unsigned int i, unsigned int j) {
+  // Pairs are found once unless elements are duplicated in leaves
+  if (_index->getInsertion() != Insertion::Bounds)
+    return true;
+
+  // Same bounds as the index
+  if (_config.continuous) {
+    const Particles::Motions motions = _particles.getMotions();
+    return Spatial::owns(*_index, leaf, Spatial::bounds(motions, i), Spatial::bounds(motions, j));
+  }
+
+  return Spatial::owns(*_index, leaf, Spatial::bounds(_particles, i), Spatial::bounds(_particles, j));
+}
@@ -0,0 +1,87 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.hpp"
+
+bool Snapshot::save(const std::string& path, const Particles& particles, const sf::Rect<int>& area,
+                    std::uint64_t steps, double timeStep) {
+  FILE* file = std::fopen(path.c_str(), "wb");
+
+  if (file == nullptr)
+    return false;
+
+  const Header header = {MAGIC, VERSION, particles.size(), std::uint32_t(area.width), std::uint32_t(area.height),
+                         std::uint32_t(std::lround(1 / timeStep)), steps};
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+  for (auto array: {&particles.x, &particles.y, &particles.vx, &particles.vy, &particles.radius})
+    written = written && std::fwrite(array->data(), sizeof(float), array->size(), file) == array->size();
+
+  return std::fclose(file) == 0 && written;
+}
+
+bool Snapshot::load(const std::string& path, Particles* particles, Header* header) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat info;
+
+  if (fd < 0)
+    return false;
+
+  if (fstat(fd, &info) != 0 || std::size_t(info.st_size) < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  *header = *static_cast<const Header*>(data);
+  const std::size_t expected = sizeof(Header) + 5 * sizeof(float) * std::size_t(header->count);
+  const bool valid = header->magic == MAGIC && header->version == VERSION && header->rate > 0
+                  && std::size_t(info.st_size) == expected;
+
+  if (valid) {
+    const float* x = reinterpret_cast<const float*>(static_cast<const char*>(data) + sizeof(Header));
+    const float* y = x + header->count;
+    const float* vx = y + header->count;
+    const float* vy = vx + header->count;
+    const float* radius = vy + header->count;
+
+    particles->clear();
+    for (std::uint32_t i=0; i<header->count; i++)
+      particles->spawn(sf::Vector2f(x[i], y[i]), sf::Vector2f(vx[i], vy[i]), radius[i]);
+  }
+
+  munmap(data, info.st_size);
+  return valid;
+}
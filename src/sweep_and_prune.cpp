@@ -0,0 +1,83 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include <algorithm>
+#include "sweep_and_prune.hpp"
+
+void SweepAndPrune::update(const Particles& particles, bool swept) {
+  const unsigned int n = particles.size();
+
+  // Swept intervals span the positions before and after the last update
+  auto measure = [&](Interval& interval) {
+    const EntityId id = interval.id;
+    const float r = particles.radius[id];
+    const float from = swept ? particles.px[id] : particles.x[id];
+
+    interval.min = std::min(from, particles.x[id]) - r;
+    interval.max = std::max(from, particles.x[id]) + r;
+  };
+
+  // New particles: last order is lost, sort from scratch
+  if (_intervals.size() != n) {
+    _intervals.resize(n);
+    for (EntityId id=0; id<n; id++)
+      _intervals[id].id = id;
+
+    for (auto& interval: _intervals)
+      measure(interval);
+
+    std::sort(_intervals.begin(), _intervals.end(), [](const Interval& a, const Interval& b) {
+      return a.min < b.min;
+    });
+  }
+  else {
+    for (auto& interval: _intervals)
+      measure(interval);
+
+    // Insertion sort: few and short moves on a nearly sorted array
+    for (unsigned int k=1; k<n; k++) {
+      Interval interval = _intervals[k];
+      unsigned int m = k;
+
+      for (; m > 0 && _intervals[m-1].min > interval.min; m--)
+        _intervals[m] = _intervals[m-1];
+
+      _intervals[m] = interval;
+    }
+  }
+
+  _ids.resize(n);
+  _ends.resize(n);
+
+  for (unsigned int k=0; k<n; k++)
+    _ids[k] = _intervals[k].id;
+
+  // Sweep: the run of particle k stops at the first one starting after
+  // its right side
+  for (unsigned int k=0; k<n; k++) {
+    unsigned int end = k + 1;
+    while (end < n && _intervals[end].min <= _intervals[k].max)
+      end++;
+    _ends[k] = end;
+  }
+}
@@ -0,0 +1,108 @@
+/* MIT License
+
+Copyright (c) 2022 Pierre Lefebvre
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE. */
+
+
+#include "workers.hpp"
+
+Workers::Workers(unsigned int count):
+  _queues(count > 0 ? count : 1), _threads(), _mutex(), _start(), _done(),
+  _generation(0), _running(0), _stop(false), _task(nullptr) {
+
+  for (auto& queue: _queues) {
+    queue.next = 0;
+    queue.end = 0;
+  }
+
+  // Worker 0 is the thread calling run()
+  for (unsigned int i=1; i<_queues.size(); i++)
+    _threads.emplace_back(&Workers::_loop, this, i);
+}
+
+Workers::~Workers() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _start.notify_all();
+
+  for (auto& thread: _threads)
+    thread.join();
+}
+
+void Workers::run(unsigned int count, const Task& task) {
+  unsigned int n = _queues.size();
+
+  // Split items in contiguous ranges
+  for (unsigned int i=0; i<n; i++) {
+    _queues[i].next = (unsigned long) count * i / n;
+    _queues[i].end = (unsigned long) count * (i+1) / n;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _task = &task;
+    _running = _threads.size();
+    _generation++;
+  }
+  _start.notify_all();
+
+  _work(0);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _done.wait(lock, [this] { return _running == 0; });
+  _task = nullptr;
+}
+
+void Workers::_loop(unsigned int worker) {
+  unsigned long generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _start.wait(lock, [&] { return _stop || _generation != generation; });
+
+      if (_stop)
+        return;
+
+      generation = _generation;
+    }
+
+    _work(worker);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (--_running == 0)
+      _done.notify_one();
+  }
+}
+
+void Workers::_work(unsigned int worker) {
+  unsigned int n = _queues.size();
+
+  // Own range first, then the others in turn
+  for (unsigned int k=0; k<n; k++) {
+    Queue& queue = _queues[(worker + k) % n];
+    unsigned int item;
+
+    while ((item = queue.next.fetch_add(1)) < queue.end)
+      (*_task)(worker, item);
+  }
+}